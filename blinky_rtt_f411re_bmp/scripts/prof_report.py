@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+"""
+Rapport "à plat" du profiler statistique (src/profiler.c).
+
+Le script lit le flux texte émis par la cible (RTT via /dev/ttyBmpTarg,
+ou console UART sous qemu), ne garde que les lignes commençant par '$',
+et résout les adresses avec la table des symboles de zephyr.elf.
+
+exemples:
+    # capture pendant 10 secondes sur la sonde BMP, puis rapport
+    timeout 10 cat /dev/ttyBmpTarg > prof.txt
+    ./scripts/prof_report.py build/zephyr/zephyr.elf prof.txt
+
+    # sous qemu, directement depuis la sortie de west
+    west build -t run | ./scripts/prof_report.py build/zephyr/zephyr.elf -
+"""
+
+import argparse
+import bisect
+import collections
+import re
+import subprocess
+import sys
+
+SAMPLE_RE = re.compile(r"\$([0-9a-fA-F]{8}) ([0-9a-fA-F]{8})\s*$")
+RATE_RE = re.compile(r"\$R (\d+)")
+THREAD_RE = re.compile(r"\$T ([0-9a-fA-F]{8}) (.*)$")
+DROP_RE = re.compile(r"\$D (\d+)")
+
+
+class SymbolTable:
+    """Table triée des symboles de zephyr.elf, extraite avec nm."""
+
+    def __init__(self, elf, nm):
+        out = subprocess.run([nm, "-n", "-S", "--defined-only", elf],
+                             check=True, capture_output=True, text=True).stdout
+        self.addrs = []
+        self.syms = []
+        for line in out.splitlines():
+            fields = line.split()
+            if len(fields) == 4:
+                addr, size, kind, name = fields
+                size = int(size, 16)
+            elif len(fields) == 3:
+                addr, kind, name = fields
+                size = 0
+            else:
+                continue
+            if kind in "tTwWbBdD":
+                # le bit 0 d'une adresse de fonction thumb vaut 1 dans certaines tables
+                self.addrs.append(int(addr, 16) & ~1)
+                self.syms.append((name, size))
+
+    def lookup(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if i < 0:
+            return None
+        name, size = self.syms[i]
+        if size and addr >= self.addrs[i] + size:
+            return None
+        return name
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="build/zephyr/zephyr.elf")
+    parser.add_argument("capture", help="fichier de capture, ou '-' pour stdin")
+    parser.add_argument("--nm", default="arm-zephyr-eabi-nm",
+                        help="outil nm de la toolchain (défaut: %(default)s)")
+    parser.add_argument("--addr2line", default="arm-zephyr-eabi-addr2line",
+                        help="outil addr2line de la toolchain (défaut: %(default)s)")
+    parser.add_argument("-n", "--top", type=int, default=20,
+                        help="nombre de fonctions affichées (défaut: %(default)s)")
+    parser.add_argument("-l", "--lines", action="store_true",
+                        help="affiche aussi les lignes source les plus chaudes")
+    args = parser.parse_args()
+
+    symbols = SymbolTable(args.elf, args.nm)
+
+    rate = None
+    drops = 0
+    thread_names = {}
+    pcs = collections.Counter()
+    funcs = collections.Counter()
+    threads = collections.Counter()
+
+    capture = sys.stdin if args.capture == "-" else open(args.capture, errors="replace")
+    for line in capture:
+        # le log RTT et la console peuvent préfixer la ligne, on cherche le premier '$'
+        pos = line.find("$")
+        if pos < 0:
+            continue
+        line = line[pos:].rstrip()
+
+        m = SAMPLE_RE.match(line)
+        if m:
+            pc = int(m.group(1), 16) & ~1
+            thread = int(m.group(2), 16)
+            pcs[pc] += 1
+            funcs[symbols.lookup(pc) or f"0x{pc:08x}"] += 1
+            threads[thread] += 1
+            continue
+        m = THREAD_RE.match(line)
+        if m:
+            thread_names[int(m.group(1), 16)] = m.group(2)
+            continue
+        m = RATE_RE.match(line)
+        if m:
+            rate = int(m.group(1))
+            continue
+        m = DROP_RE.match(line)
+        if m:
+            drops = int(m.group(1))
+
+    total = sum(funcs.values())
+    if total == 0:
+        sys.exit("aucun échantillon trouvé dans la capture")
+
+    duration = f", ~{total / rate:.1f} s à {rate} Hz" if rate else ""
+    print(f"{total} échantillons{duration}, {drops} perdus\n")
+
+    print(f"{'%':>6} {'samples':>8}  fonction")
+    for name, count in funcs.most_common(args.top):
+        print(f"{100.0 * count / total:6.2f} {count:8d}  {name}")
+
+    print(f"\n{'%':>6} {'samples':>8}  thread")
+    for thread, count in threads.most_common():
+        name = thread_names.get(thread) or symbols.lookup(thread) or "?"
+        print(f"{100.0 * count / total:6.2f} {count:8d}  0x{thread:08x} {name}")
+
+    if args.lines:
+        hot = pcs.most_common(args.top)
+        out = subprocess.run([args.addr2line, "-e", args.elf, "-f", "-C", "-s"]
+                             + [f"0x{pc:x}" for pc, _ in hot],
+                             check=True, capture_output=True, text=True).stdout.splitlines()
+        print(f"\n{'%':>6} {'samples':>8}  adresse    ligne")
+        for i, (pc, count) in enumerate(hot):
+            func, loc = out[2 * i], out[2 * i + 1]
+            print(f"{100.0 * count / total:6.2f} {count:8d}  0x{pc:08x} {loc} ({func})")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,58 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	benchmark de l'application blinky (CONFIG_APP_BENCH=y), voir common/bench/bench_report.h.
+
+	on mesure le coût d'un appel aux trois fonctions d'affichage utilisées dans main.c:
+	LOG_DBG, printk et printf, avec le même message.
+	le coût dépend directement du backend: RTT sur la carte, UART sous qemu, stdout sous native_sim.
+
+	attention, sous native_sim le temps est simulé et n'avance pas pendant l'exécution du code:
+	ces mesures n'ont de sens que sous qemu_cortex_m3 (ou sur la carte).
+*/
+
+#include <stdio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "bench_report.h"
+
+LOG_MODULE_REGISTER(bench, LOG_LEVEL_DBG);
+
+#define BENCH_APP "blinky_rtt_f411re_bmp"
+#define BENCH_LOOPS 20
+
+static void bench_thread_fn(void *p1, void *p2, void *p3)
+{
+	struct bench_stat log_stat = BENCH_STAT_INIT("log_dbg", "ns");
+	struct bench_stat printk_stat = BENCH_STAT_INIT("printk", "ns");
+	struct bench_stat printf_stat = BENCH_STAT_INIT("printf", "ns");
+	uint32_t start;
+
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	for (int i = 0; i < BENCH_LOOPS; i++) {
+		start = k_cycle_get_32();
+		LOG_DBG("%d:LED state: %s", i, "ON");
+		bench_stat_add(&log_stat, bench_elapsed_ns(start));
+
+		start = k_cycle_get_32();
+		printk("%d:printk:LED state: %s\r\n", i, "ON");
+		bench_stat_add(&printk_stat, bench_elapsed_ns(start));
+
+		start = k_cycle_get_32();
+		printf("%d:printf:LED state: %s\r\n", i, "ON");
+		bench_stat_add(&printf_stat, bench_elapsed_ns(start));
+	}
+
+	bench_report(BENCH_APP, &log_stat);
+	bench_report(BENCH_APP, &printk_stat);
+	bench_report(BENCH_APP, &printf_stat);
+	bench_done(BENCH_APP);
+}
+
+K_THREAD_DEFINE(bench_thread, 1024, bench_thread_fn, NULL, NULL, NULL,
+		K_LOWEST_APPLICATION_THREAD_PRIO, 0, CONFIG_APP_BENCH_START_DELAY_MS);
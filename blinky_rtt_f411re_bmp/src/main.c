@@ -9,6 +9,10 @@
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/logging/log.h>
 
+#ifdef CONFIG_APP_PROFILER
+#include "profiler.h"
+#endif
+
 LOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
 
 /* 1000 msec = 1 sec */
@@ -43,6 +47,17 @@ int main(void)
 		return 0;
 	}
 
+#ifdef CONFIG_APP_PROFILER
+	/*
+		le profiler échantillonne le PC et le thread courant, et envoie les échantillons sur RTT.
+		voir src/profiler.h et scripts/prof_report.py
+	*/
+	ret = profiler_start();
+	if (ret < 0) {
+		LOG_ERR("profiler start: %d", ret);
+	}
+#endif
+
 	while (1) {
 		counter++;
 		
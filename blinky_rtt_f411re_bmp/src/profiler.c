@@ -0,0 +1,364 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	profiler statistique par échantillonnage du PC (voir profiler.h).
+
+	deux sources d'interruption sont possibles, au choix dans Kconfig:
+
+	- CONFIG_APP_PROFILER_SOURCE_STM32_TIM: un timer matériel dédié (TIM5 sur le STM32F411)
+	  dont le vecteur d'interruption pointe directement sur notre handler, sans passer
+	  par le wrapper d'interruption de zephyr. à l'entrée du handler, le registre LR contient
+	  la valeur EXC_RETURN qui indique sur quelle pile (MSP ou PSP) le processeur a empilé
+	  le contexte interrompu. la trame empilée contient r0-r3, r12, lr, pc, xpsr:
+	  le PC interrompu est donc le 7ème mot de la trame.
+
+	- CONFIG_APP_PROFILER_SOURCE_K_TIMER: un timer du kernel, dont la fonction d'expiration
+	  est appelée depuis l'interruption du tick système. on ne sait plus où se trouve
+	  la trame sur la pile MSP, mais les threads tournent sur la pile PSP qui n'est pas
+	  modifiée pendant l'interruption: on y lit le PC du thread interrompu.
+	  c'est le mode dégradé utilisable sous qemu_cortex_m3.
+
+	le handler d'interruption ne fait que ranger le couple (pc, thread) dans un buffer
+	circulaire à un seul producteur (l'ISR) et un seul consommateur (le thread d'envoi),
+	ce qui ne nécessite aucun verrou.
+*/
+
+#include <stdio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/irq.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
+#include <zephyr/sys/util.h>
+#include <cmsis_core.h>
+
+#ifdef CONFIG_USE_SEGGER_RTT
+#include <SEGGER_RTT.h>
+#endif
+
+#ifdef CONFIG_APP_PROFILER_SOURCE_STM32_TIM
+#include <soc.h>
+#include <zephyr/drivers/clock_control.h>
+#include <zephyr/drivers/clock_control/stm32_clock_control.h>
+#endif
+
+#include "profiler.h"
+
+#define PROF_BUF_MASK (CONFIG_APP_PROFILER_BUF_SAMPLES - 1)
+
+BUILD_ASSERT((CONFIG_APP_PROFILER_BUF_SAMPLES & PROF_BUF_MASK) == 0,
+	     "CONFIG_APP_PROFILER_BUF_SAMPLES must be a power of 2");
+
+/* la table des threads est réémise toutes les 5 secondes pour un host qui se connecte en cours de route */
+#define PROF_THREAD_TABLE_PERIOD_MS 5000
+
+struct prof_sample {
+	uint32_t pc;
+	uint32_t thread;
+};
+
+static struct prof_sample prof_buf[CONFIG_APP_PROFILER_BUF_SAMPLES];
+
+/*
+	head n'est écrit que par l'ISR, tail que par le thread d'envoi.
+	les deux compteurs tournent librement, head - tail est le nombre d'échantillons en attente.
+*/
+static volatile uint32_t prof_head;
+static volatile uint32_t prof_tail;
+/* incrémenté par l'ISR et par le thread d'envoi */
+static atomic_t prof_dropped;
+static volatile bool prof_running;
+
+static inline void prof_record(uint32_t pc)
+{
+	uint32_t head = prof_head;
+
+	if (head - prof_tail >= CONFIG_APP_PROFILER_BUF_SAMPLES) {
+		atomic_inc(&prof_dropped);
+		return;
+	}
+
+	prof_buf[head & PROF_BUF_MASK].pc = pc;
+	prof_buf[head & PROF_BUF_MASK].thread = (uint32_t)k_current_get();
+
+	/* l'échantillon doit être écrit en mémoire avant de le publier au consommateur */
+	barrier_dmem_fence_full();
+	prof_head = head + 1;
+}
+
+/*
+	source d'interruption: timer matériel STM32
+*/
+#ifdef CONFIG_APP_PROFILER_SOURCE_STM32_TIM
+
+#define PROF_TIMER_NODE DT_NODELABEL(timers5)
+
+/* le timer matériel tient la fréquence demandée, à l'arrondi de son horloge près */
+#define PROF_RATE_HZ CONFIG_APP_PROFILER_RATE_HZ
+
+#ifdef CONFIG_ZERO_LATENCY_IRQS
+#define PROF_IRQ_FLAGS IRQ_ZERO_LATENCY
+#else
+#define PROF_IRQ_FLAGS 0
+#endif
+
+static TIM_TypeDef *const prof_tim = (TIM_TypeDef *)DT_REG_ADDR(PROF_TIMER_NODE);
+
+/*
+	appelé par prof_tim_isr avec r0 = adresse de la trame d'exception.
+	cette fonction doit avoir un lien externe pour être référencée depuis l'assembleur.
+*/
+__used void prof_tim_sample(const uint32_t *frame)
+{
+	/* acquittement de l'interruption de mise à jour du timer */
+	prof_tim->SR = ~TIM_SR_UIF;
+
+	prof_record(frame[6]);
+}
+
+/*
+	handler "nu": aucun prologue ne doit toucher à la pile avant la lecture de MSP.
+	le bit 2 de EXC_RETURN vaut 0 si la trame est sur MSP (contexte interrompu = autre ISR),
+	1 si elle est sur PSP (contexte interrompu = thread).
+	le saut final est un appel terminal: prof_tim_sample retourne directement de l'exception.
+*/
+__attribute__((naked)) static void prof_tim_isr(void)
+{
+	__asm__ volatile(
+		"tst lr, #4\n\t"
+		"ite eq\n\t"
+		"mrseq r0, msp\n\t"
+		"mrsne r0, psp\n\t"
+		"b prof_tim_sample\n\t");
+}
+
+static int prof_source_start(void)
+{
+	const struct device *clk = DEVICE_DT_GET(STM32_CLOCK_CONTROL_NODE);
+	struct stm32_pclken pclken = {
+		.bus = DT_CLOCKS_CELL(PROF_TIMER_NODE, bus),
+		.enr = DT_CLOCKS_CELL(PROF_TIMER_NODE, bits),
+	};
+	uint32_t rate;
+	int ret;
+
+	ret = clock_control_on(clk, (clock_control_subsys_t)&pclken);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = clock_control_get_rate(clk, (clock_control_subsys_t)&pclken, &rate);
+	if (ret < 0) {
+		return ret;
+	}
+
+	/*
+		l'horloge des timers est le double de celle du bus APB1
+		dès que le prédiviseur APB1 est différent de 1 (ici 96MHz pour un APB1 à 48MHz)
+	*/
+	if (STM32_APB1_PRESCALER > 1) {
+		rate *= 2;
+	}
+
+	IRQ_DIRECT_CONNECT(DT_IRQN(PROF_TIMER_NODE), CONFIG_APP_PROFILER_IRQ_PRIO,
+			   prof_tim_isr, PROF_IRQ_FLAGS);
+
+	prof_tim->CR1 = 0;
+	prof_tim->PSC = 0;
+	prof_tim->ARR = rate / PROF_RATE_HZ - 1;
+	prof_tim->CNT = 0;
+	prof_tim->EGR = TIM_EGR_UG;
+	prof_tim->SR = 0;
+	prof_tim->DIER = TIM_DIER_UIE;
+
+	irq_enable(DT_IRQN(PROF_TIMER_NODE));
+	prof_tim->CR1 = TIM_CR1_CEN;
+
+	return 0;
+}
+
+static void prof_source_stop(void)
+{
+	prof_tim->CR1 = 0;
+	prof_tim->DIER = 0;
+	irq_disable(DT_IRQN(PROF_TIMER_NODE));
+}
+
+#endif /* CONFIG_APP_PROFILER_SOURCE_STM32_TIM */
+
+/*
+	source d'interruption: timer du kernel (mode dégradé)
+*/
+#ifdef CONFIG_APP_PROFILER_SOURCE_K_TIMER
+
+/*
+	la période d'un timer du kernel est un nombre entier de ticks: on l'arrondit
+	au supérieur pour ne jamais dépasser la fréquence demandée, et c'est la fréquence
+	effective qui est annoncée dans l'enregistrement $R.
+*/
+#define PROF_TIMER_TICKS DIV_ROUND_UP(CONFIG_SYS_CLOCK_TICKS_PER_SEC, CONFIG_APP_PROFILER_RATE_HZ)
+#define PROF_RATE_HZ (CONFIG_SYS_CLOCK_TICKS_PER_SEC / PROF_TIMER_TICKS)
+
+static void prof_timer_expiry(struct k_timer *timer)
+{
+	const uint32_t *frame = (const uint32_t *)__get_PSP();
+
+	prof_record(frame[6]);
+}
+
+K_TIMER_DEFINE(prof_timer, prof_timer_expiry, NULL);
+
+static int prof_source_start(void)
+{
+	k_timer_start(&prof_timer, K_TICKS(PROF_TIMER_TICKS), K_TICKS(PROF_TIMER_TICKS));
+	return 0;
+}
+
+static void prof_source_stop(void)
+{
+	k_timer_stop(&prof_timer);
+}
+
+#endif /* CONFIG_APP_PROFILER_SOURCE_K_TIMER */
+
+/*
+	envoi des enregistrements texte.
+	sur RTT, le mode NO_BLOCK_SKIP abandonne une écriture qui ne tient pas entièrement
+	dans le buffer: on ne bloque jamais, et on comptabilise les échantillons perdus.
+*/
+#ifdef CONFIG_USE_SEGGER_RTT
+static uint8_t prof_rtt_buf[CONFIG_APP_PROFILER_RTT_BUFFER_SIZE];
+#endif
+
+static bool prof_write(const char *buf, size_t len)
+{
+#ifdef CONFIG_USE_SEGGER_RTT
+	return SEGGER_RTT_Write(CONFIG_APP_PROFILER_RTT_CHANNEL, buf, len) == len;
+#else
+	printk("%.*s", (int)len, buf);
+	return true;
+#endif
+}
+
+static void prof_thread_entry_cb(const struct k_thread *thread, void *user_data)
+{
+	char line[48];
+	const char *name = k_thread_name_get((k_tid_t)thread);
+	int len;
+
+	len = snprintf(line, sizeof(line), "$T %08x %s\n", (uint32_t)thread,
+		       (name != NULL && name[0] != '\0') ? name : "?");
+	prof_write(line, MIN(len, sizeof(line) - 1));
+}
+
+/*
+	les échantillons sont regroupés par paquets de 6 lignes de 19 caractères
+	pour limiter le nombre d'appels à SEGGER_RTT_Write.
+*/
+#define PROF_LINE_LEN 19
+#define PROF_LINES_PER_WRITE 6
+
+static void prof_flush(void)
+{
+	char chunk[PROF_LINE_LEN * PROF_LINES_PER_WRITE + 1];
+	uint32_t tail = prof_tail;
+	uint32_t head = prof_head;
+
+	barrier_dmem_fence_full();
+
+	while (tail != head) {
+		size_t len = 0;
+		uint32_t count = 0;
+
+		while (tail != head && count < PROF_LINES_PER_WRITE) {
+			const struct prof_sample *s = &prof_buf[tail & PROF_BUF_MASK];
+
+			len += snprintf(&chunk[len], sizeof(chunk) - len, "$%08x %08x\n",
+					s->pc, s->thread);
+			tail++;
+			count++;
+		}
+
+		/* on libère les emplacements avant l'envoi, qui peut être lent sur la console */
+		prof_tail = tail;
+
+		if (!prof_write(chunk, len)) {
+			atomic_add(&prof_dropped, count);
+		}
+	}
+}
+
+static void prof_thread_fn(void *p1, void *p2, void *p3)
+{
+	uint32_t reported_drops = 0;
+	int64_t next_table = 0;
+	char line[24];
+	int len;
+
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+#ifdef CONFIG_USE_SEGGER_RTT
+	SEGGER_RTT_ConfigUpBuffer(CONFIG_APP_PROFILER_RTT_CHANNEL, "prof", prof_rtt_buf,
+				  sizeof(prof_rtt_buf), SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+#endif
+
+	while (true) {
+		k_msleep(CONFIG_APP_PROFILER_FLUSH_MS);
+
+		if (!prof_running && prof_head == prof_tail) {
+			continue;
+		}
+
+		if (k_uptime_get() >= next_table) {
+			len = snprintf(line, sizeof(line), "$R %d\n", PROF_RATE_HZ);
+			prof_write(line, len);
+			k_thread_foreach_unlocked(prof_thread_entry_cb, NULL);
+			next_table = k_uptime_get() + PROF_THREAD_TABLE_PERIOD_MS;
+		}
+
+		prof_flush();
+
+		if ((uint32_t)atomic_get(&prof_dropped) != reported_drops) {
+			reported_drops = atomic_get(&prof_dropped);
+			len = snprintf(line, sizeof(line), "$D %u\n", reported_drops);
+			prof_write(line, len);
+		}
+	}
+}
+
+/*
+	le thread d'envoi a la priorité applicative la plus basse: il ne doit pas perturber
+	l'application mesurée. s'il n'a pas le temps de vider le buffer,
+	les échantillons perdus sont comptés et signalés au host.
+*/
+K_THREAD_DEFINE(prof_thread, 1024, prof_thread_fn, NULL, NULL, NULL,
+		K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+
+int profiler_start(void)
+{
+	int ret;
+
+	if (prof_running) {
+		return -EALREADY;
+	}
+
+	ret = prof_source_start();
+	if (ret < 0) {
+		return ret;
+	}
+
+	prof_running = true;
+	return 0;
+}
+
+void profiler_stop(void)
+{
+	if (!prof_running) {
+		return;
+	}
+
+	prof_source_stop();
+	prof_running = false;
+}
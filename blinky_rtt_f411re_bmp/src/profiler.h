@@ -0,0 +1,30 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	profiler statistique par échantillonnage du PC.
+
+	une interruption périodique relève l'adresse de l'instruction interrompue (PC)
+	et le thread courant. les échantillons sont stockés dans un buffer circulaire,
+	puis envoyés sur RTT (ou la console) par un thread de basse priorité,
+	sous forme de lignes texte:
+
+	$R <fréquence en Hz>		fréquence effective, émise avec la table des threads
+	$<pc> <thread>				un échantillon, adresses en hexadécimal sur 8 caractères
+	$T <thread> <nom>			table des threads, émise au démarrage puis toutes les 5 s
+	$D <nombre>					nombre total d'échantillons perdus (buffer plein)
+
+	le script scripts/prof_report.py résout les adresses avec zephyr.elf
+	et affiche un profil "à plat" des fonctions les plus chaudes.
+*/
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+/* démarre l'échantillonnage, retourne 0 ou un code d'erreur négatif */
+int profiler_start(void);
+
+/* arrête l'échantillonnage, les échantillons en attente sont tout de même envoyés */
+void profiler_stop(void);
+
+#endif /* PROFILER_H_ */
@@ -0,0 +1,43 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#include "bench_report.h"
+
+void bench_stat_add(struct bench_stat *stat, uint32_t value)
+{
+	stat->n++;
+	stat->sum += value;
+	stat->min = MIN(stat->min, value);
+	stat->max = MAX(stat->max, value);
+}
+
+void bench_report(const char *app, const struct bench_stat *stat)
+{
+	uint32_t avg = (stat->n != 0) ? (uint32_t)(stat->sum / stat->n) : 0;
+
+	/*
+		une seule ligne par mesure, pour que twister puisse la capturer avec une regex.
+		la carte est celle passée à west build (-b), ce qui permet de comparer
+		native_sim et qemu_cortex_m3.
+	*/
+	printk("BENCH {\"app\":\"%s\",\"board\":\"%s\",\"metric\":\"%s\",\"unit\":\"%s\","
+	       "\"n\":%u,\"min\":%u,\"avg\":%u,\"max\":%u}\n",
+	       app, CONFIG_BOARD, stat->metric, stat->unit, stat->n,
+	       (stat->n != 0) ? stat->min : 0, avg, stat->max);
+}
+
+void bench_done(const char *app)
+{
+	printk("BENCH DONE %s\n", app);
+}
+
+FUNC_NORETURN void bench_fail(const char *app, const char *what)
+{
+	printk("BENCH FAIL %s: %s\n", app, what);
+	k_panic();
+	CODE_UNREACHABLE;
+}
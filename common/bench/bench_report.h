@@ -0,0 +1,54 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	fonctions communes aux benchmarks des applications (src/bench.c de chaque projet).
+
+	une mesure est accumulée dans une struct bench_stat (min, moyenne, max),
+	puis affichée sur une ligne JSON préfixée par "BENCH ", par exemple:
+	BENCH {"app":"stepper_samd21","board":"native_sim","metric":"debounce_latency","unit":"us","n":10,"min":30000,"avg":30050,"max":30100}
+	twister enregistre ces lignes dans twister.json (voir sample.yaml de chaque projet),
+	et scripts/bench_collect.py les rassemble et les compare.
+*/
+
+#ifndef BENCH_REPORT_H_
+#define BENCH_REPORT_H_
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+struct bench_stat {
+	const char *metric;
+	const char *unit;
+	uint32_t n;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+};
+
+#define BENCH_STAT_INIT(_metric, _unit)                                                            \
+	{                                                                                          \
+		.metric = (_metric), .unit = (_unit), .min = UINT32_MAX,                           \
+	}
+
+void bench_stat_add(struct bench_stat *stat, uint32_t value);
+
+/* affiche la ligne "BENCH {json}" d'une mesure */
+void bench_report(const char *app, const struct bench_stat *stat);
+
+/* signale la fin du benchmark à twister */
+void bench_done(const char *app);
+
+/*
+	vérification fonctionnelle ratée: affiche "BENCH FAIL <app>: <what>" puis arrête
+	le programme sur une erreur fatale, que twister compte comme un échec du scénario.
+*/
+FUNC_NORETURN void bench_fail(const char *app, const char *what);
+
+/* temps écoulé depuis start (valeur de k_cycle_get_32()), en nanosecondes */
+static inline uint32_t bench_elapsed_ns(uint32_t start)
+{
+	return (uint32_t)k_cyc_to_ns_floor64(k_cycle_get_32() - start);
+}
+
+#endif /* BENCH_REPORT_H_ */
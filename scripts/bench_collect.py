@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+"""
+Rassemble les résultats des benchmarks (lignes "BENCH {json}" enregistrées
+par twister) dans un seul fichier JSON, et compare avec une exécution précédente.
+
+exemples:
+    west twister -T blinky_rtt_f411re_bmp -T stepper_samd21 -T spi_shell_nrf52 \\
+        -p native_sim -p qemu_cortex_m3
+    ./scripts/bench_collect.py twister-out/twister.json -o bench.json
+
+    # plus tard, après une mise à jour de zephyr ou un changement de configuration
+    ./scripts/bench_collect.py twister-out/twister.json --compare bench.json
+"""
+
+import argparse
+import json
+import sys
+
+
+def collect(twister_json):
+    with open(twister_json) as f:
+        report = json.load(f)
+
+    env = report.get("environment", {})
+    results = []
+    for suite in report.get("testsuites", []):
+        for record in suite.get("recording") or []:
+            try:
+                result = json.loads(record["result"])
+            except (KeyError, ValueError):
+                continue
+            result["platform"] = suite.get("platform")
+            result["scenario"] = suite.get("name")
+            results.append(result)
+
+    return {
+        "zephyr_version": env.get("zephyr_version"),
+        "commit_date": env.get("commit_date"),
+        "results": results,
+    }
+
+
+def key(result):
+    return (result["app"], result["platform"], result["metric"])
+
+
+def compare(current, baseline, threshold):
+    base = {key(r): r for r in baseline["results"]}
+    regressions = 0
+
+    print(f"baseline: {baseline.get('zephyr_version')}  current: {current.get('zephyr_version')}")
+    print(f"{'app':<24} {'platform':<16} {'metric':<20} {'base':>10} {'current':>10} {'delta':>8}")
+    for r in sorted(current["results"], key=key):
+        b = base.get(key(r))
+        if b is None:
+            print(f"{r['app']:<24} {r['platform']:<16} {r['metric']:<20} {'-':>10} {r['avg']:>10}")
+            continue
+        delta = (100.0 * (r["avg"] - b["avg"]) / b["avg"]) if b["avg"] else 0.0
+        flag = ""
+        if delta > threshold:
+            flag = "  <- regression"
+            regressions += 1
+        print(f"{r['app']:<24} {r['platform']:<16} {r['metric']:<20} "
+              f"{b['avg']:>10} {r['avg']:>10} {delta:>+7.1f}%{flag}")
+
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("twister_json", help="twister-out/twister.json")
+    parser.add_argument("-o", "--output", help="fichier JSON de sortie (défaut: stdout)")
+    parser.add_argument("--compare", metavar="BASELINE",
+                        help="fichier JSON d'une exécution précédente")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="augmentation de la moyenne signalée comme régression, "
+                             "en %% (défaut: %(default)s)")
+    args = parser.parse_args()
+
+    current = collect(args.twister_json)
+    if not current["results"]:
+        sys.exit("aucun résultat BENCH dans " + args.twister_json)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(current, f, indent=2)
+    elif not args.compare:
+        json.dump(current, sys.stdout, indent=2)
+        print()
+
+    if args.compare:
+        with open(args.compare) as f:
+            baseline = json.load(f)
+        if compare(current, baseline, args.threshold):
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,228 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	benchmark de l'application spi shell (CONFIG_APP_BENCH=y), voir common/bench/bench_report.h.
+
+	on mesure la durée d'un appel à spi_transceive pour différentes tailles de transfert,
+	sur le contrôleur spi émulé de boards/emul.dtsi. le périphérique émulé répond sans délai,
+	la mesure correspond donc au coût logiciel de l'API et du driver (le "overhead"),
+	qui s'ajoute au temps de transfert sur le bus réel.
+
+	avec CONFIG_APP_SPI_FLASH=y, on mesure aussi la lecture de la flash émulée par spi_flash.c:
+	le crc de 64 Ko à partir d'un cache vide, le nombre de transactions spi nécessaires
+	(réduit par la lecture anticipée), et une petite lecture servie par le cache.
+	avant les mesures, on vérifie que les données lues sont bien celles de la mémoire émulée
+	(voir bench_flash_check): en cas d'erreur le scénario échoue avec "BENCH FAIL".
+
+	attention, sous native_sim le temps est simulé et n'avance pas pendant l'exécution du code:
+	ces mesures n'ont de sens que sous qemu_cortex_m3.
+*/
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/spi.h>
+
+#include "bench_report.h"
+
+#ifdef CONFIG_APP_SPI_FLASH
+#include "spi_emul.h"
+#include "spi_flash.h"
+
+/* le contenu lu est vérifié avec le motif de la mémoire émulée */
+#ifndef CONFIG_APP_SPI_TARGET_EMUL
+#error "the flash benchmark needs the emulated spi target (boards/emul.dtsi)"
+#endif
+#endif
+
+#define BENCH_APP "spi_shell_nrf52"
+#define BENCH_LOOPS 50
+
+static const struct spi_dt_spec bench_spi =
+	SPI_DT_SPEC_GET(DT_NODELABEL(spi_target), SPI_OP_MODE_MASTER | SPI_WORD_SET(8), 0);
+
+static uint8_t bench_tx[4096];
+static uint8_t bench_rx[sizeof(bench_tx)];
+
+static const struct {
+	size_t len;
+	const char *metric;
+} bench_sizes[] = {
+	{1, "spi_trx_1B"},
+	{18, "spi_trx_18B"},	/* taille maximale d'une commande "spi trx" */
+	{256, "spi_trx_256B"},
+	{4096, "spi_trx_4096B"},
+};
+
+#ifdef CONFIG_APP_SPI_FLASH
+#define BENCH_FLASH_REGION (64 * 1024)
+#define BENCH_FLASH_LOOPS 5
+#define BENCH_SECTOR CONFIG_APP_SPI_FLASH_SECTOR_SIZE
+
+/*
+	crc32 IEEE des BENCH_FLASH_REGION premiers octets de la mémoire émulée, calculé sur le host:
+	python3 -c 'import zlib; print(hex(zlib.crc32(bytes((a ^ a >> 8 ^ a >> 16) & 0xff
+	for a in range(65536)))))'
+*/
+#define BENCH_FLASH_CRC 0x7a23bd80
+
+/*
+	lit une zone avec spi_flash_read et la compare octet par octet au motif de spi_emul.c.
+	le buffer est d'abord rempli avec l'inverse du motif, pour qu'un octet
+	qui n'aurait pas été écrit soit détecté.
+*/
+static void check_read(uint32_t addr, size_t len, const char *what)
+{
+	char msg[64];
+
+	for (size_t i = 0; i < len; i++) {
+		bench_rx[i] = ~spi_target_emul_pattern(addr + i);
+	}
+
+	if (spi_flash_read(bench_spi.bus, &bench_spi.config, addr, bench_rx, len) < 0) {
+		snprintk(msg, sizeof(msg), "%s: spi_flash_read failed", what);
+		bench_fail(BENCH_APP, msg);
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		if (bench_rx[i] != spi_target_emul_pattern(addr + i)) {
+			snprintk(msg, sizeof(msg), "%s: wrong byte at 0x%x", what,
+				 (uint32_t)(addr + i));
+			bench_fail(BENCH_APP, msg);
+		}
+	}
+}
+
+/*
+	un défaut du cache LRU, de la lecture anticipée ou du calcul des décalages donnerait
+	des données fausses sans changer les temps mesurés: on vérifie d'abord le contenu.
+*/
+static void bench_flash_check(void)
+{
+	struct spi_flash_stats before;
+	struct spi_flash_stats after;
+	uint32_t crc;
+
+	BUILD_ASSERT(sizeof(bench_rx) >= BENCH_SECTOR, "bench_rx must hold a whole sector");
+
+	spi_flash_stats_reset();
+
+	check_read(0x123, 100, "unaligned read");
+	check_read(BENCH_SECTOR - 50, 200, "cross-sector read");
+
+	/* zone déjà en cache: aucune nouvelle lecture sur le bus */
+	spi_flash_stats_get(&before);
+	check_read(0x100, 64, "cached read");
+	spi_flash_stats_get(&after);
+	if (after.misses != before.misses) {
+		bench_fail(BENCH_APP, "cached read: unexpected cache miss");
+	}
+
+	/* un secteur entier, non aligné, par le chemin de la lecture anticipée */
+	check_read(5 * BENCH_SECTOR + 0x321, BENCH_SECTOR, "read-ahead read");
+
+	/*
+		des secteurs éloignés, non consécutifs, remplacent tout le cache:
+		le secteur 0 doit être relu sur le bus, et correctement.
+	*/
+	for (int i = 0; i < CONFIG_APP_SPI_FLASH_CACHE_SECTORS; i++) {
+		check_read((64 + 2 * i) * BENCH_SECTOR + 7, 16, "eviction fill");
+	}
+	spi_flash_stats_get(&before);
+	check_read(0x100, 64, "read after eviction");
+	spi_flash_stats_get(&after);
+	if (after.misses == before.misses) {
+		bench_fail(BENCH_APP, "read after eviction: sector 0 still cached");
+	}
+
+	spi_flash_stats_reset();
+	if (spi_flash_crc32(bench_spi.bus, &bench_spi.config, 0, BENCH_FLASH_REGION, &crc) < 0) {
+		bench_fail(BENCH_APP, "crc: spi_flash_crc32 failed");
+	}
+	if (crc != BENCH_FLASH_CRC) {
+		bench_fail(BENCH_APP, "crc: wrong crc32 of the first 64 KiB");
+	}
+}
+
+static void bench_flash(void)
+{
+	struct bench_stat crc_stat = BENCH_STAT_INIT("spi_flash_crc_64KiB_cold", "us");
+	struct bench_stat transfers = BENCH_STAT_INIT("spi_flash_crc_64KiB_transfers", "count");
+	struct bench_stat hot = BENCH_STAT_INIT("spi_flash_read_16B_cached", "ns");
+	struct spi_flash_stats stats;
+	uint8_t data[16];
+	uint32_t crc;
+
+	for (int i = 0; i < BENCH_FLASH_LOOPS; i++) {
+		uint32_t start;
+
+		spi_flash_stats_reset();
+		start = k_cycle_get_32();
+		if (spi_flash_crc32(bench_spi.bus, &bench_spi.config, 0, BENCH_FLASH_REGION,
+				    &crc) < 0 || crc != BENCH_FLASH_CRC) {
+			bench_fail(BENCH_APP, "crc: wrong crc32 of the first 64 KiB");
+		}
+		bench_stat_add(&crc_stat, bench_elapsed_ns(start) / NSEC_PER_USEC);
+
+		spi_flash_stats_get(&stats);
+		bench_stat_add(&transfers, stats.transfers);
+	}
+
+	/* le secteur est dans le cache après la première lecture */
+	for (int i = 0; i < BENCH_LOOPS; i++) {
+		uint32_t start = k_cycle_get_32();
+
+		if (spi_flash_read(bench_spi.bus, &bench_spi.config, 0x100, data, sizeof(data)) < 0) {
+			bench_fail(BENCH_APP, "cached read: spi_flash_read failed");
+		}
+		if (i > 0) {
+			bench_stat_add(&hot, bench_elapsed_ns(start));
+		}
+	}
+
+	bench_report(BENCH_APP, &crc_stat);
+	bench_report(BENCH_APP, &transfers);
+	bench_report(BENCH_APP, &hot);
+}
+#endif /* CONFIG_APP_SPI_FLASH */
+
+static void bench_thread_fn(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	if (!spi_is_ready_dt(&bench_spi)) {
+		printk("BENCH spi not ready\n");
+		bench_done(BENCH_APP);
+		return;
+	}
+
+	for (size_t s = 0; s < ARRAY_SIZE(bench_sizes); s++) {
+		struct bench_stat stat = BENCH_STAT_INIT(bench_sizes[s].metric, "ns");
+		const struct spi_buf tx_buf = {.buf = bench_tx, .len = bench_sizes[s].len};
+		const struct spi_buf rx_buf = {.buf = bench_rx, .len = bench_sizes[s].len};
+		const struct spi_buf_set tx_set = {.buffers = &tx_buf, .count = 1};
+		const struct spi_buf_set rx_set = {.buffers = &rx_buf, .count = 1};
+
+		for (int i = 0; i < BENCH_LOOPS; i++) {
+			uint32_t start = k_cycle_get_32();
+
+			if (spi_transceive_dt(&bench_spi, &tx_set, &rx_set) < 0) {
+				break;
+			}
+			bench_stat_add(&stat, bench_elapsed_ns(start));
+		}
+
+		bench_report(BENCH_APP, &stat);
+	}
+
+#ifdef CONFIG_APP_SPI_FLASH
+	bench_flash_check();
+	bench_flash();
+#endif
+
+	bench_done(BENCH_APP);
+}
+
+K_THREAD_DEFINE(bench_thread, 1024, bench_thread_fn, NULL, NULL, NULL,
+		K_LOWEST_APPLICATION_THREAD_PRIO, 0, CONFIG_APP_BENCH_START_DELAY_MS);
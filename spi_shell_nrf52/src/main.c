@@ -22,11 +22,16 @@
 
 // #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/gpio.h>
 #include <zephyr/drivers/spi.h>
 #include <zephyr/shell/shell.h>
 
+#ifdef CONFIG_APP_SPI_FLASH
+#include "spi_flash.h"
+#endif
+
 
 /* The devicetree node identifier for the "led0" alias. */
 #define LED0_NODE DT_ALIAS(led0)
@@ -150,6 +155,14 @@ static int cmd_spi_trx(const struct shell *ctx, size_t argc, char **argv)
 	*/
 	int ret = spi_transceive(spi_device, &config, &tx_buf_set, &rx_buf_set);
 
+#ifdef CONFIG_APP_SPI_FLASH
+	/*
+		la commande envoyée a pu modifier le contenu de la flash (écriture, effacement),
+		les secteurs en cache ne sont plus fiables.
+	*/
+	spi_flash_invalidate();
+#endif
+
 	if (ret < 0) {
 		shell_error(ctx, "spi_transceive returned %d", ret);
 		return ret;
@@ -245,12 +258,252 @@ out:
 	config.operation = operation;
 	spi_device = dev;
 
+#ifdef CONFIG_APP_SPI_FLASH
+	spi_flash_invalidate();
+#endif
+
+	return 0;
+}
+
+#ifdef CONFIG_APP_SPI_FLASH
+/*
+	commandes "spi flash ..." pour lire une mémoire flash NOR spi externe.
+	au lieu de taper l'opcode 0x03 et l'adresse avec "spi trx", limité à 18 octets par commande,
+	on passe par le moteur de lecture de spi_flash.c: lecture anticipée par gros transferts DMA
+	et cache des derniers secteurs lus. le crc d'une zone est calculé sur la cible,
+	seul le résultat est affiché.
+
+	les adresses et longueurs acceptent le décimal ou l'hexadécimal (préfixe 0x).
+*/
+static int parse_u32(const struct shell *ctx, const char *arg, uint32_t *value)
+{
+	char *end;
+
+	*value = strtoul(arg, &end, 0);
+	if (end == arg || *end != '\0') {
+		shell_error(ctx, "invalid number %s", arg);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int parse_region(const struct shell *ctx, char **argv, uint32_t *addr, uint32_t *len)
+{
+	if (spi_device == NULL) {
+		shell_error(ctx, "SPI device isn't configured. Use `spi conf`");
+		return -ENODEV;
+	}
+	if (parse_u32(ctx, argv[1], addr) < 0 || parse_u32(ctx, argv[2], len) < 0) {
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int cmd_spi_flash_id(const struct shell *ctx, size_t argc, char **argv)
+{
+	uint8_t id[3];
+	int ret;
+
+	if (spi_device == NULL) {
+		shell_error(ctx, "SPI device isn't configured. Use `spi conf`");
+		return -ENODEV;
+	}
+
+	ret = spi_flash_jedec_id(spi_device, &config, id);
+	if (ret < 0) {
+		shell_error(ctx, "jedec id failed: %d", ret);
+		return ret;
+	}
+
+	/* l'octet de capacité est le log2 de la taille en octets pour la plupart des fabricants */
+	shell_print(ctx, "JEDEC ID: %02x %02x %02x", id[0], id[1], id[2]);
+	if (IN_RANGE(id[2], 10, 31)) {
+		shell_print(ctx, "size: %u KiB", (uint32_t)(BIT(id[2]) / 1024));
+	}
+	return 0;
+}
+
+/* buffer de lecture des commandes read et dump, multiple de la largeur d'une ligne */
+#define FLASH_CHUNK 256
+
+static int cmd_spi_flash_read(const struct shell *ctx, size_t argc, char **argv)
+{
+	static uint8_t data[FLASH_CHUNK];
+	char hex[2 * 32 + 1];
+	uint32_t addr;
+	uint32_t len;
+	int ret;
+
+	ret = parse_region(ctx, argv, &addr, &len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* sortie compacte, facile à relire par un script: "<adresse>: <32 octets en hexa>" */
+	while (len > 0) {
+		uint32_t chunk = MIN(len, FLASH_CHUNK);
+
+		ret = spi_flash_read(spi_device, &config, addr, data, chunk);
+		if (ret < 0) {
+			shell_error(ctx, "read failed at 0x%06x: %d", addr, ret);
+			return ret;
+		}
+
+		for (uint32_t off = 0; off < chunk; off += 32) {
+			size_t n = MIN(chunk - off, 32);
+
+			bin2hex(&data[off], n, hex, sizeof(hex));
+			shell_print(ctx, "%06x: %s", addr + off, hex);
+		}
+		addr += chunk;
+		len -= chunk;
+	}
 	return 0;
 }
 
+static int cmd_spi_flash_dump(const struct shell *ctx, size_t argc, char **argv)
+{
+	static uint8_t data[FLASH_CHUNK];
+	uint32_t addr;
+	uint32_t len;
+	int ret;
+
+	ret = parse_region(ctx, argv, &addr, &len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	while (len > 0) {
+		uint32_t chunk = MIN(len, FLASH_CHUNK);
+
+		ret = spi_flash_read(spi_device, &config, addr, data, chunk);
+		if (ret < 0) {
+			shell_error(ctx, "read failed at 0x%06x: %d", addr, ret);
+			return ret;
+		}
+
+		for (uint32_t off = 0; off < chunk; off += SHELL_HEXDUMP_BYTES_IN_LINE) {
+			shell_hexdump_line(ctx, addr + off, &data[off],
+					   MIN(chunk - off, SHELL_HEXDUMP_BYTES_IN_LINE));
+		}
+		addr += chunk;
+		len -= chunk;
+	}
+	return 0;
+}
+
+static int flash_crc(const struct shell *ctx, char **argv, uint32_t *crc)
+{
+	uint32_t addr;
+	uint32_t len;
+	int64_t start;
+	int ret;
+
+	ret = parse_region(ctx, argv, &addr, &len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	start = k_uptime_get();
+	ret = spi_flash_crc32(spi_device, &config, addr, len, crc);
+	if (ret < 0) {
+		shell_error(ctx, "crc failed: %d", ret);
+		return ret;
+	}
+
+	shell_print(ctx, "crc32 0x%08x (%u bytes, %u ms)", *crc, len,
+		    (uint32_t)(k_uptime_get() - start));
+	return 0;
+}
+
+static int cmd_spi_flash_crc(const struct shell *ctx, size_t argc, char **argv)
+{
+	uint32_t crc;
+
+	return flash_crc(ctx, argv, &crc);
+}
+
+static int cmd_spi_flash_cmp(const struct shell *ctx, size_t argc, char **argv)
+{
+	uint32_t expected;
+	uint32_t crc;
+	int ret;
+
+	if (parse_u32(ctx, argv[3], &expected) < 0) {
+		return -EINVAL;
+	}
+
+	ret = flash_crc(ctx, argv, &crc);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (crc != expected) {
+		shell_error(ctx, "MISMATCH, expected 0x%08x", expected);
+		return -EIO;
+	}
+
+	shell_print(ctx, "match");
+	return 0;
+}
+
+static int cmd_spi_flash_stats(const struct shell *ctx, size_t argc, char **argv)
+{
+	struct spi_flash_stats stats;
+
+	if (argc > 1) {
+		if (strcmp(argv[1], "reset") != 0) {
+			shell_error(ctx, "unknown option %s", argv[1]);
+			return -EINVAL;
+		}
+		spi_flash_stats_reset();
+	}
+
+	spi_flash_stats_get(&stats);
+	shell_print(ctx, "cache hits: %u, misses: %u", stats.hits, stats.misses);
+	shell_print(ctx, "bus transfers: %u, bytes: %u", stats.transfers, stats.bus_bytes);
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_spi_flash_cmds,
+			       SHELL_CMD_ARG(id, NULL,
+					     "Read the JEDEC ID (0x9F)\n"
+					     "Usage: spi flash id",
+					     cmd_spi_flash_id, 1, 0),
+			       SHELL_CMD_ARG(read, NULL,
+					     "Read a region, compact hex output\n"
+					     "Usage: spi flash read <address> <length>",
+					     cmd_spi_flash_read, 3, 0),
+			       SHELL_CMD_ARG(dump, NULL,
+					     "Hexdump a region\n"
+					     "Usage: spi flash dump <address> <length>",
+					     cmd_spi_flash_dump, 3, 0),
+			       SHELL_CMD_ARG(crc, NULL,
+					     "CRC32 (IEEE, zlib) of a region, computed on the target\n"
+					     "Usage: spi flash crc <address> <length>",
+					     cmd_spi_flash_crc, 3, 0),
+			       SHELL_CMD_ARG(cmp, NULL,
+					     "Compare the CRC32 of a region with an expected value\n"
+					     "Usage: spi flash cmp <address> <length> <crc32>\n"
+					     "example: spi flash cmp 0 0x100000 0x1c291ca3",
+					     cmd_spi_flash_cmp, 4, 0),
+			       SHELL_CMD_ARG(stats, NULL,
+					     "Sector cache statistics\n"
+					     "Usage: spi flash stats [reset]\n"
+					     "reset - clear the counters and empty the cache",
+					     cmd_spi_flash_stats, 1, 1),
+			       SHELL_SUBCMD_SET_END);
+
+#define SUB_SPI_FLASH_CMDS (&sub_spi_flash_cmds)
+#else
+/* SHELL_COND_CMD évalue toujours son argument, même si la commande est désactivée */
+#define SUB_SPI_FLASH_CMDS NULL
+#endif /* CONFIG_APP_SPI_FLASH */
+
 
 /*
 	les macros suivantes créent la commande "spi", et deux sous-commandes statiques "conf" et "trx".
+	la sous-commande "flash" a elle-même ses propres sous-commandes (sub_spi_flash_cmds).
 	la macro SHELL_STATIC_SUBCMD_SET_CREATE déclare une table de sous-commandes SHELL_CMD_ARG, 
 	qui se termine par une macro SHELL_SUBCMD_SET_END (=NULL).
 	SHELL_CMD_ARG prend notamment en paramètre la fonction handler associée à la sous-commande.c
@@ -271,6 +524,9 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_spi_cmds,
 					     "Transceive data to and from an SPI device\n"
 					     "Usage: spi trx <TX byte 1> [<TX byte 2> ...]",
 					     cmd_spi_trx, 2, MAX_SPI_BYTES),
+			       SHELL_COND_CMD(CONFIG_APP_SPI_FLASH, flash, SUB_SPI_FLASH_CMDS,
+					      "SPI NOR flash commands (id, read, dump, crc, cmp, stats)",
+					      NULL),
 			       SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(spi, &sub_spi_cmds, "SPI commands", NULL);
@@ -0,0 +1,182 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	émulateur de périphérique spi, pour native_sim et qemu_cortex_m3 (voir boards/emul.dtsi).
+
+	le contrôleur zephyr,spi-emul-controller transmet chaque appel à spi_transceive
+	à l'émulateur dont l'adresse (reg) correspond au champ slave de la configuration spi.
+	l'émulateur voit la transaction octet par octet: pour chaque octet émis par le maître
+	(0 si le buffer d'émission est plus court ou NULL), il fournit l'octet reçu.
+
+	le périphérique se comporte comme une mémoire flash NOR pour les commandes
+	JEDEC ID (0x9F), READ (0x03) et FAST READ (0x0B), avec une adresse sur 24 bits.
+	la mémoire n'est pas stockée: l'octet à l'adresse a vaut (a ^ (a >> 8) ^ (a >> 16)) & 0xff,
+	ce qui permet de recalculer sur le host le crc d'une zone.
+	pour toute autre commande il renvoie simplement ce qu'il reçoit (loopback).
+*/
+
+#define DT_DRV_COMPAT app_spi_target_emul
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/spi.h>
+#include <zephyr/drivers/spi_emul.h>
+#include <zephyr/sys/util.h>
+
+#include "spi_emul.h"
+
+/*
+	curseur sur un ensemble de buffers spi (spi_buf_set), parcouru octet par octet.
+	un buffer dont le pointeur est NULL correspond à des octets ignorés.
+*/
+struct buf_cursor {
+	const struct spi_buf_set *set;
+	size_t idx;
+	size_t off;
+};
+
+static size_t buf_set_len(const struct spi_buf_set *set)
+{
+	size_t len = 0;
+
+	for (size_t i = 0; (set != NULL) && (i < set->count); i++) {
+		len += set->buffers[i].len;
+	}
+	return len;
+}
+
+/* retourne l'adresse de l'octet courant et avance, NULL si l'octet est ignoré ou hors des buffers */
+static uint8_t *cursor_next(struct buf_cursor *c)
+{
+	while ((c->set != NULL) && (c->idx < c->set->count)) {
+		const struct spi_buf *buf = &c->set->buffers[c->idx];
+
+		if (c->off < buf->len) {
+			uint8_t *p = (buf->buf != NULL) ? (uint8_t *)buf->buf + c->off : NULL;
+
+			c->off++;
+			return p;
+		}
+		c->idx++;
+		c->off = 0;
+	}
+	return NULL;
+}
+
+#define CMD_READ 0x03
+#define CMD_FAST_READ 0x0b
+#define CMD_JEDEC_ID 0x9f
+
+/* identifiant JEDEC: fabricant Winbond, type NOR série, la capacité est ajoutée selon la taille */
+#define EMUL_JEDEC_MANUFACTURER 0xef
+#define EMUL_JEDEC_TYPE 0x40
+
+struct spi_target_emul_cfg {
+	uint32_t size;
+};
+
+/* état de la transaction en cours */
+struct spi_target_emul_data {
+	uint8_t opcode;
+	uint32_t addr;
+};
+
+uint8_t spi_target_emul_pattern(uint32_t addr)
+{
+	return (addr ^ (addr >> 8) ^ (addr >> 16)) & 0xff;
+}
+
+/* réponse du périphérique à l'octet tx, en position pos depuis le début de la transaction */
+static uint8_t spi_target_emul_xfer(const struct emul *target, size_t pos, uint8_t tx)
+{
+	const struct spi_target_emul_cfg *cfg = target->cfg;
+	struct spi_target_emul_data *data = target->data;
+	size_t header;
+
+	if (pos == 0) {
+		data->opcode = tx;
+		data->addr = 0;
+	}
+
+	switch (data->opcode) {
+	case CMD_JEDEC_ID:
+		switch (pos) {
+		case 1:
+			return EMUL_JEDEC_MANUFACTURER;
+		case 2:
+			return EMUL_JEDEC_TYPE;
+		case 3:
+			return LOG2(cfg->size);
+		default:
+			return 0xff;
+		}
+
+	case CMD_READ:
+	case CMD_FAST_READ:
+		/* en-tête: commande, 3 octets d'adresse, plus un octet factice pour FAST READ */
+		header = (data->opcode == CMD_FAST_READ) ? 5 : 4;
+		if (IN_RANGE(pos, 1, 3)) {
+			data->addr = (data->addr << 8) | tx;
+		}
+		if (pos < header) {
+			return 0xff;
+		}
+		/* comme une vraie flash, la lecture reboucle à la fin de la mémoire */
+		return spi_target_emul_pattern((data->addr + pos - header) & (cfg->size - 1));
+
+	default:
+		return tx;
+	}
+}
+
+static int spi_target_emul_io(const struct emul *target, const struct spi_config *config,
+			      const struct spi_buf_set *tx_bufs, const struct spi_buf_set *rx_bufs)
+{
+	struct buf_cursor tx = {.set = tx_bufs};
+	struct buf_cursor rx = {.set = rx_bufs};
+	size_t len = MAX(buf_set_len(tx_bufs), buf_set_len(rx_bufs));
+
+	ARG_UNUSED(config);
+
+	for (size_t pos = 0; pos < len; pos++) {
+		uint8_t *tx_byte = cursor_next(&tx);
+		uint8_t *rx_byte = cursor_next(&rx);
+		uint8_t value = spi_target_emul_xfer(target, pos, (tx_byte != NULL) ? *tx_byte : 0);
+
+		if (rx_byte != NULL) {
+			*rx_byte = value;
+		}
+	}
+
+	return 0;
+}
+
+static const struct spi_emul_api spi_target_emul_api = {
+	.io = spi_target_emul_io,
+};
+
+static int spi_target_emul_init(const struct emul *target, const struct device *parent)
+{
+	ARG_UNUSED(target);
+	ARG_UNUSED(parent);
+
+	return 0;
+}
+
+/*
+	un émulateur est toujours associé au device du même noeud devicetree,
+	ici un device vide puisque l'application parle directement au contrôleur spi.
+*/
+#define SPI_TARGET_EMUL_DEFINE(n)                                                                  \
+	BUILD_ASSERT(IS_POWER_OF_TWO(DT_INST_PROP(n, size)), "size must be a power of 2");         \
+	static const struct spi_target_emul_cfg spi_target_emul_cfg_##n = {                        \
+		.size = DT_INST_PROP(n, size),                                                     \
+	};                                                                                         \
+	static struct spi_target_emul_data spi_target_emul_data_##n;                               \
+	DEVICE_DT_INST_DEFINE(n, NULL, NULL, NULL, NULL, POST_KERNEL,                              \
+			      CONFIG_APPLICATION_INIT_PRIORITY, NULL);                             \
+	EMUL_DT_INST_DEFINE(n, spi_target_emul_init, &spi_target_emul_data_##n,                    \
+			    &spi_target_emul_cfg_##n, &spi_target_emul_api, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(SPI_TARGET_EMUL_DEFINE)
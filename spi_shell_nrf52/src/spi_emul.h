@@ -0,0 +1,16 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	émulateur de mémoire flash NOR spi (CONFIG_APP_SPI_TARGET_EMUL=y), voir spi_emul.c.
+*/
+
+#ifndef SPI_EMUL_H_
+#define SPI_EMUL_H_
+
+#include <stdint.h>
+
+/* contenu de la mémoire émulée à l'adresse addr (inférieure à sa taille) */
+uint8_t spi_target_emul_pattern(uint32_t addr);
+
+#endif /* SPI_EMUL_H_ */
@@ -0,0 +1,292 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	lecture d'une mémoire flash NOR spi externe, avec lecture anticipée et cache de secteurs
+	(voir spi_flash.h).
+*/
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/spi.h>
+#include <zephyr/sys/crc.h>
+
+#include "spi_flash.h"
+
+#define SECTOR_SIZE CONFIG_APP_SPI_FLASH_SECTOR_SIZE
+#define CACHE_SECTORS CONFIG_APP_SPI_FLASH_CACHE_SECTORS
+#define MAX_FETCH (CONFIG_APP_SPI_FLASH_READ_AHEAD + 1)
+
+/*
+	une lecture anticipée ne doit jamais remplacer tout le cache: le secteur utilisé
+	le plus récemment (celui que l'on vient de lire) doit y rester.
+*/
+BUILD_ASSERT(MAX_FETCH < CACHE_SECTORS,
+	     "CONFIG_APP_SPI_FLASH_READ_AHEAD must be at most CONFIG_APP_SPI_FLASH_CACHE_SECTORS - 2");
+
+#define CMD_JEDEC_ID 0x9f
+#define CMD_FAST_READ 0x0b
+
+/* adresse sur 24 bits */
+#define FLASH_ADDR_LIMIT BIT(24)
+#define FLASH_SECTOR_LIMIT (FLASH_ADDR_LIMIT / SECTOR_SIZE)
+
+struct cache_entry {
+	uint32_t sector;
+	uint32_t last_use;
+	bool valid;
+};
+
+/*
+	les données des secteurs sont en RAM, ce qui permet au contrôleur spi
+	de les remplir directement par DMA (EasyDMA sur le nrf52840).
+*/
+static uint8_t cache_data[CACHE_SECTORS][SECTOR_SIZE] __aligned(4);
+static struct cache_entry cache[CACHE_SECTORS];
+static uint32_t cache_clock;
+
+/* secteur attendu si l'accès est séquentiel */
+static uint32_t seq_next = UINT32_MAX;
+
+static struct spi_flash_stats stats;
+
+K_MUTEX_DEFINE(spi_flash_lock);
+
+static int cache_find(uint32_t sector)
+{
+	for (int i = 0; i < CACHE_SECTORS; i++) {
+		if (cache[i].valid && cache[i].sector == sector) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* choisit l'emplacement à remplacer: un emplacement libre, sinon le moins récemment utilisé */
+static int cache_victim(const bool *reserved)
+{
+	int victim = -1;
+
+	for (int i = 0; i < CACHE_SECTORS; i++) {
+		if (reserved[i]) {
+			continue;
+		}
+		if (!cache[i].valid) {
+			return i;
+		}
+		if (victim < 0 || cache[i].last_use < cache[victim].last_use) {
+			victim = i;
+		}
+	}
+	return victim;
+}
+
+/*
+	lit count secteurs consécutifs à partir de sector, en une seule transaction spi:
+	l'en-tête FAST READ (commande, adresse, octet factice) est suivi des données,
+	réparties directement dans les emplacements du cache grâce à un spi_buf_set à plusieurs buffers.
+	le buffer de réception NULL correspond aux 5 octets reçus pendant l'en-tête, qui sont ignorés.
+	retourne l'emplacement du premier secteur.
+*/
+static int cache_fetch(const struct device *dev, const struct spi_config *config,
+		       uint32_t sector, uint32_t count)
+{
+	bool reserved[CACHE_SECTORS] = {false};
+	int slots[MAX_FETCH];
+	struct spi_buf rx_bufs[MAX_FETCH + 1];
+	uint32_t addr = sector * SECTOR_SIZE;
+	uint8_t cmd[5] = {CMD_FAST_READ, addr >> 16, addr >> 8, addr, 0};
+	const struct spi_buf tx_buf = {.buf = cmd, .len = sizeof(cmd)};
+	const struct spi_buf_set tx = {.buffers = &tx_buf, .count = 1};
+	const struct spi_buf_set rx = {.buffers = rx_bufs, .count = count + 1};
+	int ret;
+
+	rx_bufs[0].buf = NULL;
+	rx_bufs[0].len = sizeof(cmd);
+
+	for (uint32_t i = 0; i < count; i++) {
+		slots[i] = cache_victim(reserved);
+		reserved[slots[i]] = true;
+		cache[slots[i]].valid = false;
+		rx_bufs[i + 1].buf = cache_data[slots[i]];
+		rx_bufs[i + 1].len = SECTOR_SIZE;
+	}
+
+	ret = spi_transceive(dev, config, &tx, &rx);
+	if (ret < 0) {
+		return ret;
+	}
+
+	stats.transfers++;
+	stats.bus_bytes += count * SECTOR_SIZE;
+
+	for (uint32_t i = 0; i < count; i++) {
+		cache[slots[i]].sector = sector + i;
+		cache[slots[i]].last_use = ++cache_clock;
+		cache[slots[i]].valid = true;
+	}
+
+	/* le secteur demandé doit être le plus récent, il est utilisé immédiatement */
+	cache[slots[0]].last_use = ++cache_clock;
+
+	return slots[0];
+}
+
+/*
+	retourne l'emplacement du cache contenant sector, en le lisant si besoin.
+	last_sector est le dernier secteur de la demande en cours, qui borne la lecture anticipée
+	sauf si l'accès prolonge le précédent.
+*/
+static int cache_get(const struct device *dev, const struct spi_config *config,
+		     uint32_t sector, uint32_t last_sector)
+{
+	uint32_t want;
+	uint32_t count;
+	int slot;
+
+	slot = cache_find(sector);
+	if (slot >= 0) {
+		stats.hits++;
+		cache[slot].last_use = ++cache_clock;
+		seq_next = sector + 1;
+		return slot;
+	}
+
+	stats.misses++;
+
+	want = last_sector - sector + 1;
+	if (sector == seq_next) {
+		want = MAX(want, MAX_FETCH);
+	}
+	want = MIN(want, MAX_FETCH);
+	want = MIN(want, FLASH_SECTOR_LIMIT - sector);
+
+	/* on ne relit pas les secteurs déjà présents: la lecture s'arrête au premier trouvé */
+	for (count = 1; count < want; count++) {
+		if (cache_find(sector + count) >= 0) {
+			break;
+		}
+	}
+
+	seq_next = sector + 1;
+	return cache_fetch(dev, config, sector, count);
+}
+
+/*
+	parcourt la zone [addr, addr + len[ secteur par secteur, et appelle fn sur chaque morceau.
+	c'est le point commun de la lecture et du calcul de crc.
+*/
+typedef void (*chunk_fn_t)(const uint8_t *data, size_t len, void *user_data);
+
+static int spi_flash_walk(const struct device *dev, const struct spi_config *config,
+			  uint32_t addr, size_t len, chunk_fn_t fn, void *user_data)
+{
+	uint32_t last_sector;
+	int ret = 0;
+
+	if (dev == NULL || config == NULL) {
+		return -ENODEV;
+	}
+	if (len == 0) {
+		return 0;
+	}
+	if (addr >= FLASH_ADDR_LIMIT || len > FLASH_ADDR_LIMIT - addr) {
+		return -EINVAL;
+	}
+
+	last_sector = (addr + len - 1) / SECTOR_SIZE;
+
+	k_mutex_lock(&spi_flash_lock, K_FOREVER);
+
+	while (len > 0) {
+		uint32_t sector = addr / SECTOR_SIZE;
+		uint32_t offset = addr % SECTOR_SIZE;
+		size_t chunk = MIN(len, SECTOR_SIZE - offset);
+		int slot = cache_get(dev, config, sector, last_sector);
+
+		if (slot < 0) {
+			ret = slot;
+			break;
+		}
+
+		fn(&cache_data[slot][offset], chunk, user_data);
+		addr += chunk;
+		len -= chunk;
+	}
+
+	k_mutex_unlock(&spi_flash_lock);
+
+	return ret;
+}
+
+static void read_chunk(const uint8_t *data, size_t len, void *user_data)
+{
+	uint8_t **dst = user_data;
+
+	memcpy(*dst, data, len);
+	*dst += len;
+}
+
+int spi_flash_read(const struct device *dev, const struct spi_config *config, uint32_t addr,
+		   uint8_t *buf, size_t len)
+{
+	return spi_flash_walk(dev, config, addr, len, read_chunk, &buf);
+}
+
+static void crc_chunk(const uint8_t *data, size_t len, void *user_data)
+{
+	uint32_t *crc = user_data;
+
+	*crc = crc32_ieee_update(*crc, data, len);
+}
+
+int spi_flash_crc32(const struct device *dev, const struct spi_config *config, uint32_t addr,
+		    size_t len, uint32_t *crc)
+{
+	*crc = 0;
+	return spi_flash_walk(dev, config, addr, len, crc_chunk, crc);
+}
+
+int spi_flash_jedec_id(const struct device *dev, const struct spi_config *config, uint8_t id[3])
+{
+	uint8_t cmd = CMD_JEDEC_ID;
+	const struct spi_buf tx_buf = {.buf = &cmd, .len = 1};
+	const struct spi_buf rx_bufs[] = {
+		{.buf = NULL, .len = 1},
+		{.buf = id, .len = 3},
+	};
+	const struct spi_buf_set tx = {.buffers = &tx_buf, .count = 1};
+	const struct spi_buf_set rx = {.buffers = rx_bufs, .count = ARRAY_SIZE(rx_bufs)};
+
+	if (dev == NULL || config == NULL) {
+		return -ENODEV;
+	}
+
+	return spi_transceive(dev, config, &tx, &rx);
+}
+
+void spi_flash_invalidate(void)
+{
+	k_mutex_lock(&spi_flash_lock, K_FOREVER);
+	for (int i = 0; i < CACHE_SECTORS; i++) {
+		cache[i].valid = false;
+	}
+	seq_next = UINT32_MAX;
+	k_mutex_unlock(&spi_flash_lock);
+}
+
+void spi_flash_stats_get(struct spi_flash_stats *out)
+{
+	k_mutex_lock(&spi_flash_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&spi_flash_lock);
+}
+
+void spi_flash_stats_reset(void)
+{
+	spi_flash_invalidate();
+
+	k_mutex_lock(&spi_flash_lock, K_FOREVER);
+	memset(&stats, 0, sizeof(stats));
+	k_mutex_unlock(&spi_flash_lock);
+}
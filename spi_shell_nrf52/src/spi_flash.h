@@ -0,0 +1,57 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	lecture d'une mémoire flash NOR spi externe, avec lecture anticipée et cache de secteurs.
+
+	la mémoire est lue par secteurs de CONFIG_APP_SPI_FLASH_SECTOR_SIZE octets, gardés dans
+	un petit cache de CONFIG_APP_SPI_FLASH_CACHE_SECTORS secteurs. quand le cache est plein,
+	on remplace le secteur utilisé le moins récemment (LRU, least recently used).
+	une lecture qui tombe dans un secteur du cache ne génère aucun transfert sur le bus.
+
+	lors d'un défaut de cache (miss), si l'accès est séquentiel (le secteur suit le précédent,
+	ou la demande couvre plusieurs secteurs), on lit en une seule transaction spi jusqu'à
+	CONFIG_APP_SPI_FLASH_READ_AHEAD secteurs supplémentaires: un seul en-tête de commande
+	pour un gros transfert DMA, directement dans les emplacements du cache.
+	une transaction remplit au plus CONFIG_APP_SPI_FLASH_CACHE_SECTORS - 1 emplacements,
+	le secteur utilisé le plus récemment reste donc toujours dans le cache.
+
+	les commandes utilisées sont JEDEC ID (0x9F) et FAST READ (0x0B) avec une adresse
+	sur 24 bits, ce qui limite l'accès aux 16 premiers Mo de la mémoire.
+	toutes les fonctions retournent 0 ou un code d'erreur négatif.
+*/
+
+#ifndef SPI_FLASH_H_
+#define SPI_FLASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/spi.h>
+
+struct spi_flash_stats {
+	uint32_t hits;		/* secteurs trouvés dans le cache */
+	uint32_t misses;	/* secteurs absents du cache */
+	uint32_t transfers;	/* transactions de lecture sur le bus */
+	uint32_t bus_bytes;	/* octets de données lus sur le bus */
+};
+
+/* lit les 3 octets d'identification JEDEC: fabricant, type, capacité (log2 de la taille) */
+int spi_flash_jedec_id(const struct device *dev, const struct spi_config *config, uint8_t id[3]);
+
+int spi_flash_read(const struct device *dev, const struct spi_config *config, uint32_t addr,
+		   uint8_t *buf, size_t len);
+
+/* crc32 IEEE (celle de zlib, de python zlib.crc32 ou de la commande crc32) d'une zone */
+int spi_flash_crc32(const struct device *dev, const struct spi_config *config, uint32_t addr,
+		    size_t len, uint32_t *crc);
+
+/* vide le cache, à appeler dès que le contenu de la mémoire ou la configuration du bus change */
+void spi_flash_invalidate(void);
+
+void spi_flash_stats_get(struct spi_flash_stats *stats);
+
+/* remet les compteurs à zéro et vide le cache, pour mesurer à partir d'un cache "froid" */
+void spi_flash_stats_reset(void);
+
+#endif /* SPI_FLASH_H_ */
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Apache-2.0
+"""
+Envoie un fichier de commandes de mouvement à la cible (CONFIG_APP_MOTION_STREAM=y),
+en respectant le contrôle de flux par crédits décrit dans src/motion.h.
+
+exemples:
+    ./scripts/motion_stream.py /dev/ttyACM0 job.gcode
+    # 2000 aller-retours courts générés à la volée
+    python3 -c 'for i in range(2000): print(f"G0 X{(i % 2) * 50} F500")' \\
+        | ./scripts/motion_stream.py /dev/ttyACM0 -
+
+nécessite pyserial (pip install pyserial).
+"""
+
+import argparse
+import sys
+import time
+
+import serial
+
+
+def wait_banner(port):
+    """attend la ligne "start credits=<N>" émise au démarrage de la cible"""
+    while True:
+        line = port.readline().decode(errors="replace").strip()
+        if line.startswith("start credits="):
+            return int(line.split("=", 1)[1])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", help="port série de la cible, ex: /dev/ttyACM0")
+    parser.add_argument("gcode", help="fichier de commandes, ou '-' pour stdin")
+    parser.add_argument("-b", "--baudrate", type=int, default=115200)
+    parser.add_argument("-c", "--credits", type=int,
+                        help="nombre de crédits, si la cible a déjà démarré "
+                             "(sinon on attend la ligne \"start credits=\")")
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, args.baudrate, timeout=1)
+    credits = args.credits or wait_banner(port)
+
+    source = sys.stdin if args.gcode == "-" else open(args.gcode)
+    # les lignes vides et les commentaires seuls ne sont pas envoyés, et les espaces
+    # sont supprimés: la longueur d'une ligne est limitée en octets bruts (voir motion.h)
+    lines = ("".join(l.split(";", 1)[0].split()) for l in source)
+    lines = [l for l in lines if l]
+
+    sent = 0
+    acked = 0
+    errors = 0
+    start = time.monotonic()
+
+    while acked < len(lines):
+        while sent < len(lines) and sent - acked < credits:
+            port.write((lines[sent] + "\n").encode())
+            sent += 1
+
+        reply = port.readline().decode(errors="replace").strip()
+        if reply == "ok":
+            acked += 1
+        elif reply.startswith("error:exec"):
+            # échec d'exécution d'un mouvement déjà acquitté: pas de crédit rendu
+            errors += 1
+            print(reply, file=sys.stderr)
+        elif reply.startswith("error:"):
+            acked += 1
+            errors += 1
+            # les commandes immédiates sont acquittées avant les mouvements en file,
+            # l'ordre des réponses ne permet donc pas de retrouver la ligne fautive
+            print(reply, file=sys.stderr)
+        elif reply.startswith(("X:", "<")):
+            print(reply)
+
+    elapsed = time.monotonic() - start
+    port.write(b"?\n")
+    status = ""
+    while not status.startswith("<"):
+        status = port.readline().decode(errors="replace").strip()
+    print(f"{len(lines)} commandes en {elapsed:.1f} s "
+          f"({60 * len(lines) / elapsed:.0f}/min), {errors} erreurs, {status}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,292 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	benchmark de l'application stepper (CONFIG_APP_BENCH=y), voir common/bench/bench_report.h.
+	il tourne dans son propre thread, en parallèle de la boucle principale de main.c
+	qui fait aller et venir le moteur, sur les gpio émulées de boards/emul.dtsi.
+
+	mesures:
+	- debounce_latency: délai entre le dernier front du bouton (après quelques rebonds simulés)
+	  et l'allumage de la led par debounce_work_handler. attendu: 30 ms + le temps de traitement.
+	- debounce_spurious: nombre d'allumages de la led en trop, le filtre doit les supprimer tous.
+	- step_interval: intervalle entre deux pas successifs du moteur. attendu: 2 ms à 500 pas/s.
+	  les inversions de sens de la boucle principale apparaissent dans le max.
+	- hotlog_queued, hotlog_suppressed: coût d'un appel HOTLOG_INF vu de l'appelant, quand le
+	  message est mis en file et quand il est supprimé par la limite de débit (voir hotlog.h).
+	  les compteurs du module "bench" (émis, supprimés, perdus) sont vérifiés après chaque
+	  phase, ainsi que les pertes quand on remplit la file plus vite que le thread hotlog la vide.
+	- log_immediate: coût d'un LOG_INF équivalent, formaté et envoyé sur place
+	  avec CONFIG_LOG_MODE_IMMEDIATE=y.
+*/
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/drivers/stepper.h>
+#include <zephyr/logging/log.h>
+
+#include "bench_report.h"
+#include "hotlog.h"
+
+LOG_MODULE_REGISTER(bench);
+HOTLOG_MODULE_REGISTER(bench, CONFIG_LOG_DEFAULT_LEVEL);
+
+#define BENCH_APP "stepper_samd21"
+
+#define DEBOUNCE_PRESSES 10
+#define DEBOUNCE_BOUNCES 3
+#define DEBOUNCE_BOUNCE_MS 2
+#define DEBOUNCE_TIMEOUT_MS 200
+
+#define STEP_WINDOW_MS 1000
+
+#define LOG_ROUNDS 10
+#define LOG_BATCH 8
+#define LOG_PAUSE_MS 50
+#define LOG_FLOOD (CONFIG_APP_HOTLOG_QUEUE_SIZE + 4)
+
+#ifdef CONFIG_APP_HOTLOG
+/* un paquet et le message d'amorce tiennent dans la file: aucune perte attendue */
+BUILD_ASSERT(LOG_BATCH + 1 <= CONFIG_APP_HOTLOG_QUEUE_SIZE);
+/* à 1 message/s, le point d'appel limité ne regagne pas de jeton entre l'amorce et la fin */
+BUILD_ASSERT((LOG_ROUNDS + 1) * LOG_PAUSE_MS < 1000);
+#endif
+
+/* période de scrutation des sorties émulées */
+#define POLL_US 100
+
+static const struct gpio_dt_spec bench_led = GPIO_DT_SPEC_GET(DT_ALIAS(led0), gpios);
+static const struct gpio_dt_spec bench_button = GPIO_DT_SPEC_GET(DT_ALIAS(sw0), gpios);
+static const struct device *const bench_motor = DEVICE_DT_GET(DT_NODELABEL(motor0));
+
+/*
+	gpio_emul travaille sur les niveaux physiques,
+	on tient compte du flag GPIO_ACTIVE_LOW déclaré dans le devicetree.
+*/
+static void button_set(bool active)
+{
+	bool low = (bench_button.dt_flags & GPIO_ACTIVE_LOW) != 0;
+
+	gpio_emul_input_set(bench_button.port, bench_button.pin, active ^ low);
+}
+
+static bool led_get(void)
+{
+	bool low = (bench_led.dt_flags & GPIO_ACTIVE_LOW) != 0;
+
+	return gpio_emul_output_get(bench_led.port, bench_led.pin) ^ low;
+}
+
+static void bench_debounce(void)
+{
+	struct bench_stat latency = BENCH_STAT_INIT("debounce_latency", "us");
+	struct bench_stat spurious = BENCH_STAT_INIT("debounce_spurious", "count");
+
+	for (int i = 0; i < DEBOUNCE_PRESSES; i++) {
+		uint32_t activations = 0;
+		bool led_state = false;
+		uint32_t start;
+
+		for (int b = 0; b < DEBOUNCE_BOUNCES; b++) {
+			button_set(true);
+			k_msleep(DEBOUNCE_BOUNCE_MS);
+			button_set(false);
+			k_msleep(DEBOUNCE_BOUNCE_MS);
+		}
+		button_set(true);
+		start = k_cycle_get_32();
+
+		/* on compte les fronts montants de la led jusqu'au timeout */
+		while (bench_elapsed_ns(start) < DEBOUNCE_TIMEOUT_MS * NSEC_PER_MSEC) {
+			bool state = led_get();
+
+			if (state && !led_state) {
+				if (activations == 0) {
+					bench_stat_add(&latency, bench_elapsed_ns(start) / NSEC_PER_USEC);
+				}
+				activations++;
+			}
+			led_state = state;
+			k_usleep(POLL_US);
+		}
+
+		button_set(false);
+		bench_stat_add(&spurious, (activations > 0) ? activations - 1 : 0);
+		k_msleep(DEBOUNCE_TIMEOUT_MS);
+	}
+
+	bench_report(BENCH_APP, &latency);
+	bench_report(BENCH_APP, &spurious);
+}
+
+static void bench_steps(void)
+{
+	struct bench_stat interval = BENCH_STAT_INIT("step_interval", "us");
+	int32_t last_pos;
+	int32_t pos;
+	uint32_t last_step;
+	uint32_t start;
+
+	if (stepper_get_actual_position(bench_motor, &last_pos) < 0) {
+		return;
+	}
+
+	start = k_cycle_get_32();
+	last_step = start;
+
+	while (bench_elapsed_ns(start) < STEP_WINDOW_MS * NSEC_PER_MSEC) {
+		stepper_get_actual_position(bench_motor, &pos);
+		if (pos != last_pos) {
+			uint32_t now = k_cycle_get_32();
+
+			/* le premier intervalle part d'un instant arbitraire, on l'ignore */
+			if (last_step != start) {
+				bench_stat_add(&interval,
+					       k_cyc_to_us_floor32(now - last_step));
+			}
+			last_step = now;
+			last_pos = pos;
+		}
+		k_usleep(POLL_US);
+	}
+
+	bench_report(BENCH_APP, &interval);
+}
+
+#ifdef CONFIG_APP_HOTLOG
+struct log_counts {
+	uint32_t emitted;
+	uint32_t suppressed;
+	uint32_t dropped;
+};
+
+static void log_counts_cb(const char *module, uint32_t emitted, uint32_t suppressed,
+			  uint32_t dropped, void *user_data)
+{
+	struct log_counts *counts = user_data;
+
+	if (strcmp(module, "bench") == 0) {
+		counts->emitted = emitted;
+		counts->suppressed = suppressed;
+		counts->dropped = dropped;
+	}
+}
+
+/* compteurs du module, à zéro tant qu'il n'a utilisé aucune macro HOTLOG_xxx */
+static void log_counts_get(struct log_counts *counts)
+{
+	memset(counts, 0, sizeof(*counts));
+	hotlog_stats_foreach(log_counts_cb, counts);
+}
+
+/* vérifie les compteurs gagnés depuis before */
+static void log_counts_check(const char *what, const struct log_counts *before,
+			     uint32_t emitted, uint32_t suppressed, uint32_t dropped)
+{
+	struct log_counts after;
+	char msg[96];
+
+	log_counts_get(&after);
+	after.emitted -= before->emitted;
+	after.suppressed -= before->suppressed;
+	after.dropped -= before->dropped;
+	if (after.emitted != emitted || after.suppressed != suppressed ||
+	    after.dropped != dropped) {
+		snprintk(msg, sizeof(msg),
+			 "%s: emitted %u suppressed %u dropped %u, expected %u %u %u", what,
+			 after.emitted, after.suppressed, after.dropped,
+			 emitted, suppressed, dropped);
+		bench_fail(BENCH_APP, msg);
+	}
+}
+
+/* un seul message par seconde, et pas d'avance au-delà d'un message */
+static void log_limited(int r, int i)
+{
+	HOTLOG_INF_RATE(1, 1, "bench suppressed %d/%d", r, i);
+}
+
+/*
+	les messages sont envoyés par paquets de LOG_BATCH, plus petits que la file,
+	et la pause entre deux paquets laisse le thread hotlog les formater.
+*/
+static void bench_log(void)
+{
+	struct bench_stat queued = BENCH_STAT_INIT("hotlog_queued", "ns");
+	struct bench_stat suppressed = BENCH_STAT_INIT("hotlog_suppressed", "ns");
+	struct bench_stat immediate = BENCH_STAT_INIT("log_immediate", "ns");
+	struct log_counts before;
+	uint32_t start;
+
+	log_counts_get(&before);
+
+	/*
+		le premier appel du point d'appel limité trouve le seau plein et met son message
+		en file: on le fait hors mesure, hotlog_suppressed ne mesure que des suppressions.
+	*/
+	log_limited(-1, -1);
+	k_msleep(LOG_PAUSE_MS);
+
+	for (int r = 0; r < LOG_ROUNDS; r++) {
+		for (int i = 0; i < LOG_BATCH; i++) {
+			start = k_cycle_get_32();
+			HOTLOG_INF_RATE(1000, LOG_BATCH, "bench queued %d/%d", r, i);
+			bench_stat_add(&queued, bench_elapsed_ns(start));
+		}
+		k_msleep(LOG_PAUSE_MS);
+
+		for (int i = 0; i < LOG_BATCH; i++) {
+			start = k_cycle_get_32();
+			log_limited(r, i);
+			bench_stat_add(&suppressed, bench_elapsed_ns(start));
+		}
+
+		start = k_cycle_get_32();
+		LOG_INF("bench immediate %d", r);
+		bench_stat_add(&immediate, bench_elapsed_ns(start));
+	}
+
+	log_counts_check("hotlog rounds", &before, LOG_ROUNDS * LOG_BATCH + 1,
+			 LOG_ROUNDS * LOG_BATCH, 0);
+
+	/*
+		le thread hotlog, de priorité la plus basse, ne tourne pas tant que ce thread
+		ne se bloque pas: la file vide se remplit, et les messages suivants sont perdus.
+	*/
+	k_msleep(LOG_PAUSE_MS);
+	log_counts_get(&before);
+	for (int i = 0; i < LOG_FLOOD; i++) {
+		HOTLOG_INF_RATE(1000, LOG_FLOOD, "bench flood %d", i);
+	}
+	log_counts_check("hotlog flood", &before, CONFIG_APP_HOTLOG_QUEUE_SIZE, 0,
+			 LOG_FLOOD - CONFIG_APP_HOTLOG_QUEUE_SIZE);
+	k_msleep(LOG_PAUSE_MS);
+
+	bench_report(BENCH_APP, &queued);
+	bench_report(BENCH_APP, &suppressed);
+	bench_report(BENCH_APP, &immediate);
+}
+#endif /* CONFIG_APP_HOTLOG */
+
+static void bench_thread_fn(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	bench_debounce();
+	bench_steps();
+#ifdef CONFIG_APP_HOTLOG
+	bench_log();
+#endif
+	bench_done(BENCH_APP);
+}
+
+/*
+	même priorité que le thread main, qui passe son temps bloqué dans k_poll,
+	et plus basse que la workqueue système qui exécute le filtre anti-rebond.
+*/
+K_THREAD_DEFINE(bench_thread, 1024, bench_thread_fn, NULL, NULL, NULL,
+		CONFIG_MAIN_THREAD_PRIORITY, 0, CONFIG_APP_BENCH_START_DELAY_MS);
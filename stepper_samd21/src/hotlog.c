@@ -0,0 +1,205 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	log des chemins critiques, limité en débit et différé (voir hotlog.h).
+
+	hotlog_emit peut être appelée depuis une interruption: elle ne fait que décompter
+	un jeton du point d'appel et copier format et arguments dans la file hotlog_queue.
+	le formatage (snprintk) et l'envoi au système de log sont faits par le thread
+	hotlog_thread, de priorité la plus basse possible, quand le cpu n'a rien de mieux à faire.
+*/
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/printk.h>
+
+#include "hotlog.h"
+
+/*
+	le filtrage par niveau est déjà fait par HOTLOG_MODULE_REGISTER,
+	tout ce qui arrive ici doit être affiché.
+*/
+LOG_MODULE_REGISTER(hotlog, LOG_LEVEL_DBG);
+
+struct hotlog_msg {
+	const struct hotlog_site *site;
+	uint32_t argv[HOTLOG_MAX_ARGS];
+	uint32_t suppressed;	/* messages supprimés sur ce point d'appel depuis le précédent */
+};
+
+K_MSGQ_DEFINE(hotlog_queue, sizeof(struct hotlog_msg), CONFIG_APP_HOTLOG_QUEUE_SIZE, 4);
+
+static struct k_spinlock hotlog_lock;
+static sys_slist_t hotlog_modules = SYS_SLIST_STATIC_INIT(&hotlog_modules);
+
+/*
+	seau à jetons: les jetons sont comptés en millièmes de message pour que
+	rate (messages par seconde) corresponde à rate millièmes par milliseconde.
+	le premier appel trouve le seau plein.
+*/
+static bool site_take_token(struct hotlog_site *site, uint32_t now)
+{
+	uint32_t full = site->burst * 1000U;
+
+	if (!site->started) {
+		site->tokens = full;
+		site->started = true;
+	} else {
+		uint64_t tokens = site->tokens + (uint64_t)(now - site->last_ms) * site->rate;
+
+		site->tokens = MIN(tokens, full);
+	}
+	site->last_ms = now;
+
+	if (site->tokens < 1000U) {
+		return false;
+	}
+	site->tokens -= 1000U;
+	return true;
+}
+
+void hotlog_emit(struct hotlog_site *site, const uint32_t *argv)
+{
+	struct hotlog_module *module = site->module;
+	struct hotlog_msg msg;
+	k_spinlock_key_t key;
+	bool pass;
+
+	key = k_spin_lock(&hotlog_lock);
+	if (!module->linked) {
+		sys_slist_append(&hotlog_modules, &module->node);
+		module->linked = true;
+	}
+	pass = site_take_token(site, k_uptime_get_32());
+	if (pass) {
+		msg.suppressed = site->pending_suppressed;
+		site->pending_suppressed = 0;
+	} else {
+		site->pending_suppressed++;
+	}
+	k_spin_unlock(&hotlog_lock, key);
+
+	if (!pass) {
+		atomic_inc(&module->suppressed);
+		return;
+	}
+
+	msg.site = site;
+	memcpy(msg.argv, argv, sizeof(msg.argv));
+
+	if (k_msgq_put(&hotlog_queue, &msg, K_NO_WAIT) != 0) {
+		/*
+			file pleine: le compte des messages supprimés n'a pas été transmis,
+			on le rend au point d'appel, augmenté du message perdu, pour que
+			le prochain message affiché indique le bon nombre.
+		*/
+		key = k_spin_lock(&hotlog_lock);
+		site->pending_suppressed += msg.suppressed + 1;
+		k_spin_unlock(&hotlog_lock, key);
+		atomic_inc(&module->dropped);
+		return;
+	}
+	atomic_inc(&module->emitted);
+}
+
+static void hotlog_print(const struct hotlog_msg *msg)
+{
+	const struct hotlog_site *site = msg->site;
+	char text[CONFIG_APP_HOTLOG_LINE_MAX];
+	char more[24] = "";
+
+	/* les arguments en trop sont ignorés par le formatage, on passe toujours les 3 */
+	snprintk(text, sizeof(text), site->fmt, msg->argv[0], msg->argv[1], msg->argv[2]);
+	if (msg->suppressed > 0) {
+		snprintk(more, sizeof(more), " (%u suppressed)", msg->suppressed);
+	}
+
+	switch (site->level) {
+	case LOG_LEVEL_ERR:
+		LOG_ERR("%s: %s%s", site->module->name, text, more);
+		break;
+	case LOG_LEVEL_WRN:
+		LOG_WRN("%s: %s%s", site->module->name, text, more);
+		break;
+	case LOG_LEVEL_INF:
+		LOG_INF("%s: %s%s", site->module->name, text, more);
+		break;
+	default:
+		LOG_DBG("%s: %s%s", site->module->name, text, more);
+		break;
+	}
+}
+
+static void hotlog_thread_fn(void *p1, void *p2, void *p3)
+{
+	struct hotlog_msg msg;
+
+	while (true) {
+		k_msgq_get(&hotlog_queue, &msg, K_FOREVER);
+		hotlog_print(&msg);
+	}
+}
+
+/* priorité applicative la plus basse, quel que soit CONFIG_NUM_PREEMPT_PRIORITIES */
+K_THREAD_DEFINE(hotlog_thread, CONFIG_APP_HOTLOG_THREAD_STACK_SIZE, hotlog_thread_fn,
+		NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+
+void hotlog_stats_foreach(hotlog_stats_cb_t cb, void *user_data)
+{
+	struct hotlog_module *module;
+
+	/* la liste ne fait que grandir, et un noeud ajouté n'est plus modifié: pas besoin de verrou */
+	SYS_SLIST_FOR_EACH_CONTAINER(&hotlog_modules, module, node) {
+		cb(module->name, atomic_get(&module->emitted), atomic_get(&module->suppressed),
+		   atomic_get(&module->dropped), user_data);
+	}
+}
+
+void hotlog_stats_reset(void)
+{
+	struct hotlog_module *module;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&hotlog_modules, module, node) {
+		atomic_clear(&module->emitted);
+		atomic_clear(&module->suppressed);
+		atomic_clear(&module->dropped);
+	}
+}
+
+#ifdef CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+
+static void print_module(const char *name, uint32_t emitted, uint32_t suppressed,
+			 uint32_t dropped, void *user_data)
+{
+	const struct shell *sh = user_data;
+
+	shell_print(sh, "%-12s %10u %10u %10u", name, emitted, suppressed, dropped);
+}
+
+static int cmd_hotlog_stats(const struct shell *sh, size_t argc, char **argv)
+{
+	shell_print(sh, "%-12s %10s %10s %10s", "module", "emitted", "suppressed", "dropped");
+	hotlog_stats_foreach(print_module, (void *)sh);
+	shell_print(sh, "queue: %u/%d", k_msgq_num_used_get(&hotlog_queue),
+		    CONFIG_APP_HOTLOG_QUEUE_SIZE);
+	return 0;
+}
+
+static int cmd_hotlog_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	hotlog_stats_reset();
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_hotlog,
+	SHELL_CMD(stats, NULL, "Messages emitted, suppressed and dropped per module",
+		  cmd_hotlog_stats),
+	SHELL_CMD(reset, NULL, "Reset the counters", cmd_hotlog_reset),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(hotlog, &sub_hotlog, "Rate-limited hot path logging", NULL);
+#endif /* CONFIG_SHELL */
@@ -0,0 +1,126 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	log des chemins critiques ("hot paths"), limité en débit et différé (CONFIG_APP_HOTLOG=y).
+
+	avec CONFIG_LOG_MODE_IMMEDIATE=y, un LOG_INF dans un callback d'interruption ou dans
+	le handler anti-rebond formate et envoie le texte sur l'uart avant de rendre la main:
+	un bouton qui rebondit ou une suite de mouvements rapides inonde la console et
+	fausse les temps que l'on cherche justement à observer.
+
+	les macros HOTLOG_ERR/WRN/INF/DBG s'utilisent comme LOG_ERR/...:
+	- chaque point d'appel a son propre "seau à jetons" (token bucket): il dispose de
+	  CONFIG_APP_HOTLOG_BURST messages d'avance, et regagne CONFIG_APP_HOTLOG_RATE messages
+	  par seconde. au-delà, les messages sont supprimés et comptés (HOTLOG_INF_RATE permet
+	  de choisir le débit d'un point d'appel);
+	- le message n'est pas formaté sur place: on range seulement le format et les arguments
+	  dans une file (k_msgq), ce qui est possible depuis une interruption. un thread de basse
+	  priorité formate et envoie ensuite le message avec le système de log;
+	- si la file est pleine, le message est perdu et compté, et le prochain message affiché
+	  pour ce point d'appel l'inclut dans son nombre de messages supprimés.
+	les compteurs de chaque module (messages émis, supprimés, perdus) sont consultables avec
+	hotlog_stats_foreach() ou la commande shell "hotlog stats" si le shell est activé.
+
+	restriction: au plus 3 arguments entiers, rangés sur 32 bits (pas de %s ni de %lld,
+	puisque le formatage a lieu plus tard), et le format doit être une chaîne littérale.
+
+	sans CONFIG_APP_HOTLOG, les macros se replient sur LOG_ERR/...
+*/
+
+#ifndef HOTLOG_H_
+#define HOTLOG_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/slist.h>
+#include <zephyr/sys/util.h>
+
+#ifdef CONFIG_APP_HOTLOG
+
+#define HOTLOG_MAX_ARGS 3
+
+/* compteurs d'un module, chaîné à la liste des modules lors de son premier message */
+struct hotlog_module {
+	sys_snode_t node;
+	bool linked;
+	const char *name;
+	uint8_t level;
+	atomic_t emitted;
+	atomic_t suppressed;
+	atomic_t dropped;
+};
+
+/* état d'un point d'appel, une variable statique par macro HOTLOG_xxx */
+struct hotlog_site {
+	struct hotlog_module *module;
+	const char *fmt;
+	uint8_t level;
+	uint16_t rate;		/* messages par seconde */
+	uint16_t burst;		/* messages d'avance */
+	uint32_t tokens;	/* en millièmes de message */
+	uint32_t last_ms;
+	uint32_t pending_suppressed;
+	bool started;
+};
+
+/*
+	déclare les compteurs du module courant, à placer après LOG_MODULE_REGISTER.
+	level est le niveau maximal des messages conservés, comme pour LOG_MODULE_REGISTER.
+*/
+#define HOTLOG_MODULE_REGISTER(_name, _level)                                                      \
+	static struct hotlog_module _hotlog_module_##_name = {                                     \
+		.name = STRINGIFY(_name),                                                          \
+		.level = (_level),                                                                 \
+	};                                                                                         \
+	static struct hotlog_module *const _hotlog_current __maybe_unused = &_hotlog_module_##_name
+
+void hotlog_emit(struct hotlog_site *site, const uint32_t *argv);
+
+#define Z_HOTLOG(_level, _rate, _burst, _fmt, ...)                                                 \
+	do {                                                                                       \
+		BUILD_ASSERT(NUM_VA_ARGS_LESS_1(_, ##__VA_ARGS__) <= HOTLOG_MAX_ARGS,              \
+			     "HOTLOG: at most 3 arguments");                                       \
+		static struct hotlog_site _hotlog_site = {                                         \
+			.fmt = (_fmt),                                                             \
+			.level = (_level),                                                         \
+			.rate = (_rate),                                                           \
+			.burst = (_burst),                                                         \
+		};                                                                                 \
+		const uint32_t _hotlog_argv[HOTLOG_MAX_ARGS] = {__VA_ARGS__};                      \
+		if ((_level) <= _hotlog_current->level) {                                          \
+			_hotlog_site.module = _hotlog_current;                                     \
+			hotlog_emit(&_hotlog_site, _hotlog_argv);                                  \
+		}                                                                                  \
+	} while (false)
+
+#define HOTLOG_ERR(...) Z_HOTLOG(LOG_LEVEL_ERR, CONFIG_APP_HOTLOG_RATE, CONFIG_APP_HOTLOG_BURST, __VA_ARGS__)
+#define HOTLOG_WRN(...) Z_HOTLOG(LOG_LEVEL_WRN, CONFIG_APP_HOTLOG_RATE, CONFIG_APP_HOTLOG_BURST, __VA_ARGS__)
+#define HOTLOG_INF(...) Z_HOTLOG(LOG_LEVEL_INF, CONFIG_APP_HOTLOG_RATE, CONFIG_APP_HOTLOG_BURST, __VA_ARGS__)
+#define HOTLOG_DBG(...) Z_HOTLOG(LOG_LEVEL_DBG, CONFIG_APP_HOTLOG_RATE, CONFIG_APP_HOTLOG_BURST, __VA_ARGS__)
+
+/* même chose avec un débit (messages/s) et une avance propres au point d'appel */
+#define HOTLOG_INF_RATE(_rate, _burst, ...) Z_HOTLOG(LOG_LEVEL_INF, _rate, _burst, __VA_ARGS__)
+#define HOTLOG_DBG_RATE(_rate, _burst, ...) Z_HOTLOG(LOG_LEVEL_DBG, _rate, _burst, __VA_ARGS__)
+
+/* appelle cb pour chaque module ayant déjà utilisé une macro HOTLOG_xxx, avec ses compteurs */
+typedef void (*hotlog_stats_cb_t)(const char *module, uint32_t emitted, uint32_t suppressed,
+				  uint32_t dropped, void *user_data);
+
+void hotlog_stats_foreach(hotlog_stats_cb_t cb, void *user_data);
+
+void hotlog_stats_reset(void);
+
+#else /* CONFIG_APP_HOTLOG */
+
+#define HOTLOG_MODULE_REGISTER(_name, _level)
+#define HOTLOG_ERR(...) LOG_ERR(__VA_ARGS__)
+#define HOTLOG_WRN(...) LOG_WRN(__VA_ARGS__)
+#define HOTLOG_INF(...) LOG_INF(__VA_ARGS__)
+#define HOTLOG_DBG(...) LOG_DBG(__VA_ARGS__)
+#define HOTLOG_INF_RATE(_rate, _burst, ...) LOG_INF(__VA_ARGS__)
+#define HOTLOG_DBG_RATE(_rate, _burst, ...) LOG_DBG(__VA_ARGS__)
+
+#endif /* CONFIG_APP_HOTLOG */
+
+#endif /* HOTLOG_H_ */
@@ -20,6 +20,12 @@
 #include <zephyr/drivers/stepper.h>
 #include <zephyr/logging/log.h>
 
+#include "hotlog.h"
+
+#ifdef CONFIG_APP_MOTION_STREAM
+#include "motion.h"
+#endif
+
 /*
 	ici pas de printf et de printk
 	on utilise le systeme de log de zephyr sur le backend par defaut: la console uart.
@@ -36,6 +42,17 @@
 LOG_MODULE_REGISTER(main);
 // LOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
 
+/*
+	dans les callbacks et les handlers appelés souvent, le log immédiat bloque l'appelant
+	le temps d'envoyer le texte sur l'uart. on y utilise HOTLOG_INF/HOTLOG_DBG à la place:
+	le message est seulement mis en file (même depuis une interruption), formaté plus tard
+	par un thread de basse priorité, et limité en débit pour chaque point d'appel.
+	les messages supprimés ou perdus sont comptés (commande shell "hotlog stats").
+	voir src/hotlog.h. le niveau se règle comme celui de LOG_MODULE_REGISTER.
+*/
+HOTLOG_MODULE_REGISTER(main, CONFIG_LOG_DEFAULT_LEVEL);
+// HOTLOG_MODULE_REGISTER(main, LOG_LEVEL_DBG);
+
 
 /*
 	declaration des descripteurs de périphériques:
@@ -120,12 +137,12 @@ static void debounce_work_handler(struct k_work *work){
 	if (gpio_pin_get_dt(&button)){
 		gpio_pin_set_dt(&led, 1);
 		k_work_reschedule(&ledoff_work,K_MSEC(50));
-		LOG_INF("button pressed");
+		HOTLOG_INF("button pressed");
 	}
 	if (gpio_pin_get_dt(&endstop)){
 		gpio_pin_set_dt(&led, 1);
 		k_work_reschedule(&ledoff_work,K_MSEC(50));
-		LOG_INF("endstop pressed");
+		HOTLOG_INF("endstop pressed");
 	}	
 }	
 
@@ -154,7 +171,7 @@ static void stepper_stop_cb(const struct device *dev,
 {
 	if (event == STEPPER_EVENT_STEPS_COMPLETED){
 		k_poll_signal_raise((struct k_poll_signal *)user_data, 1);
-		LOG_DBG("signal raise");
+		HOTLOG_DBG("signal raise");
 	}
 }
 
@@ -317,6 +334,17 @@ int main(void)
 	ret = stepper_set_event_callback(motor0_dev, stepper_stop_cb, (void *)&stepper_stop_signal);
 	if (ret < 0) {LOG_ERR("stepper set event callback");return 0;}
 
+#ifdef CONFIG_APP_MOTION_STREAM
+	/*
+		au lieu du va-et-vient de démonstration, les mouvements sont envoyés par un host
+		sur l'uart, rangés dans une file et exécutés les uns après les autres.
+		motion_stream_run ne retourne qu'en cas d'erreur.
+	*/
+	LOG_INF("motion stream loop...");
+	ret = motion_stream_run(motor0_dev, &stepper_stop_event);
+	if (ret < 0) {LOG_ERR("motion stream");return 0;}
+#endif
+
 	/*
 		on entre dans la boucle infinie
 	*/
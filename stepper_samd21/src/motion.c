@@ -0,0 +1,452 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	interface de commande de mouvement en flux continu (voir motion.h).
+
+	trois contextes se partagent le travail:
+	- l'interruption uart range les octets reçus dans un buffer circulaire (ring buffer),
+	- le thread motion_rx découpe les lignes, les analyse, répond aux commandes immédiates
+	  et range les mouvements dans la file motion_queue (k_msgq),
+	- le thread main (motion_stream_run) retire les mouvements de la file, acquitte,
+	  puis les exécute en attendant le signal de fin de mouvement du driver stepper.
+
+	l'uart utilisée est celle du noeud "chosen" app,motion-uart si l'overlay en définit un,
+	sinon celle de la console. dans ce cas les lignes de log sont mélangées aux réponses,
+	le host ne doit tenir compte que des lignes "ok", "error:", "X:", "<" et "start".
+	le backend de log uart n'utilise pas motion_tx_lock: une ligne de log peut donc couper
+	une réponse en deux (voir motion.h).
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/stepper.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#include "motion.h"
+
+LOG_MODULE_REGISTER(motion);
+
+#if DT_HAS_CHOSEN(app_motion_uart)
+#define MOTION_UART_NODE DT_CHOSEN(app_motion_uart)
+#else
+#define MOTION_UART_NODE DT_CHOSEN(zephyr_console)
+#endif
+
+static const struct device *const motion_uart = DEVICE_DT_GET(MOTION_UART_NODE);
+static const struct device *motion_motor;
+
+enum motion_type {
+	MOTION_MOVE,
+	MOTION_DWELL,
+	MOTION_SET_POS,
+	MOTION_ENABLE,
+};
+
+struct motion_cmd {
+	uint8_t type;
+	bool relative;
+	int32_t value;
+	uint32_t velocity;	/* 0 = vitesse inchangée */
+};
+
+K_MSGQ_DEFINE(motion_queue, sizeof(struct motion_cmd), CONFIG_APP_MOTION_QUEUE_DEPTH, 4);
+
+/*
+	une ligne occupe au plus CONFIG_APP_MOTION_LINE_MAX octets bruts dans le buffer
+	de réception, espaces, commentaire et fin de ligne "\r\n" compris: MOTION_RAW_MAX octets
+	avant la fin de ligne, les lignes plus longues sont refusées (voir motion.h).
+	le buffer peut contenir autant de lignes que la file a d'emplacements:
+	un host qui respecte ses crédits et cette limite ne peut donc pas le faire déborder.
+*/
+#define MOTION_RAW_MAX (CONFIG_APP_MOTION_LINE_MAX - 2)
+#define MOTION_RX_SIZE (CONFIG_APP_MOTION_QUEUE_DEPTH * CONFIG_APP_MOTION_LINE_MAX)
+
+RING_BUF_DECLARE(motion_rx, MOTION_RX_SIZE);
+K_SEM_DEFINE(motion_rx_sem, 0, 1);
+K_MUTEX_DEFINE(motion_tx_lock);
+
+/* statistiques renvoyées par la commande "?" */
+static uint32_t motion_underruns;
+static uint32_t motion_overruns;
+static uint32_t motion_rx_lost;
+
+#ifdef CONFIG_APP_MOTION_XONXOFF
+#define MOTION_XON 0x11
+#define MOTION_XOFF 0x13
+static bool motion_xoff;
+#endif
+
+/*
+	les réponses sont émises en mode "polling", sous mutex pour ne pas mélanger
+	les "ok" du thread main et les réponses du thread motion_rx.
+*/
+static void motion_puts(const char *s)
+{
+	k_mutex_lock(&motion_tx_lock, K_FOREVER);
+	while (*s != '\0') {
+		uart_poll_out(motion_uart, *s++);
+	}
+	k_mutex_unlock(&motion_tx_lock);
+}
+
+static void motion_uart_isr(const struct device *dev, void *user_data)
+{
+	uint8_t buf[16];
+	uint32_t put;
+	int len;
+
+	ARG_UNUSED(user_data);
+
+	while (uart_irq_update(dev) && uart_irq_rx_ready(dev)) {
+		len = uart_fifo_read(dev, buf, sizeof(buf));
+		if (len <= 0) {
+			break;
+		}
+		put = ring_buf_put(&motion_rx, buf, len);
+		if (put < len) {
+			motion_rx_lost += len - put;
+		}
+		k_sem_give(&motion_rx_sem);
+	}
+
+#ifdef CONFIG_APP_MOTION_XONXOFF
+	/* XOFF quand il reste moins d'un quart du buffer */
+	if (!motion_xoff && ring_buf_space_get(&motion_rx) < MOTION_RX_SIZE / 4) {
+		uart_poll_out(dev, MOTION_XOFF);
+		motion_xoff = true;
+	}
+#endif
+}
+
+#ifdef CONFIG_APP_MOTION_XONXOFF
+static void motion_xon_check(void)
+{
+	unsigned int key = irq_lock();
+
+	/* XON quand le buffer est redescendu sous le quart de sa capacité */
+	if (motion_xoff && ring_buf_size_get(&motion_rx) < MOTION_RX_SIZE / 4) {
+		uart_poll_out(motion_uart, MOTION_XON);
+		motion_xoff = false;
+	}
+	irq_unlock(key);
+}
+#endif
+
+/* cherche le paramètre <letter><entier> dans la ligne, retourne false s'il est absent */
+static bool motion_param(const char *args, char letter, long *value)
+{
+	const char *p = strchr(args, letter);
+	char *end;
+
+	if (p == NULL) {
+		return false;
+	}
+	*value = strtol(p + 1, &end, 10);
+	return end != p + 1;
+}
+
+static void motion_enqueue(const struct motion_cmd *cmd)
+{
+	/*
+		la file ne peut être pleine que si le host dépasse ses crédits.
+		on le compte, puis on bloque: la réception continue dans le buffer circulaire.
+	*/
+	if (k_msgq_put(&motion_queue, cmd, K_NO_WAIT) != 0) {
+		motion_overruns++;
+		k_msgq_put(&motion_queue, cmd, K_FOREVER);
+	}
+}
+
+/*
+	analyse une ligne, sans espaces superflus, en majuscules et sans commentaire.
+	retourne NULL si la commande a été mise dans la file (le "ok" sera envoyé par l'exécution),
+	"ok" si c'est une commande immédiate, ou un message d'erreur.
+*/
+static const char *motion_parse_line(const char *line)
+{
+	static bool relative;
+	struct motion_cmd cmd = {0};
+	char reply[64];
+	char *args;
+	long code;
+	long value;
+
+	if (line[0] == '?') {
+		snprintf(reply, sizeof(reply), "<q=%u/%d underruns=%u overruns=%u lost=%u>\n",
+			 k_msgq_num_used_get(&motion_queue), CONFIG_APP_MOTION_QUEUE_DEPTH,
+			 motion_underruns, motion_overruns, motion_rx_lost);
+		motion_puts(reply);
+		return "ok";
+	}
+
+	if (line[0] != 'G' && line[0] != 'M') {
+		return "error:unknown command";
+	}
+
+	code = strtol(&line[1], &args, 10);
+	if (args == &line[1]) {
+		return "error:bad command number";
+	}
+
+	if (line[0] == 'G') {
+		switch (code) {
+		case 0:
+		case 1:
+			if (!motion_param(args, 'X', &value)) {
+				return "error:missing X";
+			}
+			cmd.type = MOTION_MOVE;
+			cmd.relative = relative;
+			cmd.value = value;
+			if (motion_param(args, 'F', &value)) {
+				if (value <= 0) {
+					return "error:bad F";
+				}
+				cmd.velocity = value;
+			}
+			break;
+		case 4:
+			if (!motion_param(args, 'P', &value) || value < 0) {
+				return "error:bad P";
+			}
+			cmd.type = MOTION_DWELL;
+			cmd.value = value;
+			break;
+		case 90:
+		case 91:
+			relative = (code == 91);
+			return "ok";
+		case 92:
+			if (!motion_param(args, 'X', &value)) {
+				return "error:missing X";
+			}
+			cmd.type = MOTION_SET_POS;
+			cmd.value = value;
+			break;
+		default:
+			return "error:unsupported G code";
+		}
+	} else {
+		switch (code) {
+		case 17:
+		case 18:
+			cmd.type = MOTION_ENABLE;
+			cmd.value = (code == 17);
+			break;
+		case 114: {
+			int32_t pos = 0;
+
+			stepper_get_actual_position(motion_motor, &pos);
+			snprintf(reply, sizeof(reply), "X:%d\n", pos);
+			motion_puts(reply);
+			return "ok";
+		}
+		default:
+			return "error:unsupported M code";
+		}
+	}
+
+	motion_enqueue(&cmd);
+	return NULL;
+}
+
+/*
+	thread de réception: assemble les lignes caractère par caractère.
+	les lignes vides sont ignorées sans réponse, ce qui permet au host
+	de terminer ses lignes par "\n" ou "\r\n" indifféremment.
+*/
+static void motion_rx_thread_fn(void *p1, void *p2, void *p3)
+{
+	char line[CONFIG_APP_MOTION_LINE_MAX];
+	char out[40];
+	size_t raw_len = 0;
+	size_t len = 0;
+	bool comment = false;
+	bool too_long = false;
+	const char *reply;
+	uint8_t c;
+
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (true) {
+		while (ring_buf_get(&motion_rx, &c, 1) == 0) {
+			k_sem_take(&motion_rx_sem, K_FOREVER);
+		}
+
+#ifdef CONFIG_APP_MOTION_XONXOFF
+		motion_xon_check();
+#endif
+
+		if (c != '\n' && c != '\r') {
+			/*
+				la limite porte sur les octets bruts, c'est elle qui borne l'occupation
+				du buffer de réception. la ligne nettoyée, plus courte, tient toujours dans line.
+			*/
+			if (raw_len < MOTION_RAW_MAX) {
+				raw_len++;
+			} else {
+				too_long = true;
+			}
+
+			/* les espaces sont supprimés, les commentaires commencent par ';' */
+			if (c == ';') {
+				comment = true;
+			}
+			if (comment || isspace(c) || too_long) {
+				continue;
+			}
+			if (len < sizeof(line) - 1) {
+				line[len++] = toupper(c);
+			}
+			continue;
+		}
+
+		line[len] = '\0';
+
+		if (too_long) {
+			reply = "error:line too long";
+		} else if (len == 0) {
+			reply = NULL;
+			if (comment) {
+				/* ligne ne contenant qu'un commentaire: acquittée pour rendre le crédit */
+				reply = "ok";
+			}
+		} else {
+			reply = motion_parse_line(line);
+		}
+
+		/* la réponse et sa fin de ligne en un seul appel, pour ne pas être coupée par un "ok" */
+		if (reply != NULL) {
+			snprintf(out, sizeof(out), "%s\n", reply);
+			motion_puts(out);
+		}
+
+		raw_len = 0;
+		len = 0;
+		comment = false;
+		too_long = false;
+	}
+}
+
+K_THREAD_DEFINE(motion_rx_thread, 1024, motion_rx_thread_fn, NULL, NULL, NULL,
+		CONFIG_MAIN_THREAD_PRIORITY, 0, SYS_FOREVER_MS);
+
+static int motion_execute(const struct device *motor, struct k_poll_event *stop_event,
+			  const struct motion_cmd *cmd)
+{
+	static uint32_t velocity;
+	int32_t pos;
+	int32_t target;
+	int ret;
+
+	switch (cmd->type) {
+	case MOTION_MOVE:
+		if (cmd->velocity != 0 && cmd->velocity != velocity) {
+			ret = stepper_set_max_velocity(motor, cmd->velocity);
+			if (ret < 0) {
+				return ret;
+			}
+			velocity = cmd->velocity;
+		}
+
+		ret = stepper_get_actual_position(motor, &pos);
+		if (ret < 0) {
+			return ret;
+		}
+
+		target = cmd->relative ? pos + cmd->value : cmd->value;
+		if (target == pos) {
+			return 0;
+		}
+
+		ret = stepper_set_target_position(motor, target);
+		if (ret < 0) {
+			return ret;
+		}
+
+		/* même mécanisme que la boucle de démonstration de main.c */
+		k_poll(stop_event, 1, K_FOREVER);
+		k_poll_signal_reset(stop_event->signal);
+		return 0;
+
+	case MOTION_DWELL:
+		k_msleep(cmd->value);
+		return 0;
+
+	case MOTION_SET_POS:
+		return stepper_set_actual_position(motor, cmd->value);
+
+	case MOTION_ENABLE:
+		return stepper_enable(motor, cmd->value != 0);
+
+	default:
+		return -EINVAL;
+	}
+}
+
+int motion_stream_run(const struct device *motor, struct k_poll_event *stop_event)
+{
+	struct motion_cmd cmd;
+	char banner[32];
+	bool busy = false;
+	int ret;
+
+	if (!device_is_ready(motion_uart)) {
+		LOG_ERR("motion uart not ready");
+		return -ENODEV;
+	}
+
+	motion_motor = motor;
+
+	ret = uart_irq_callback_user_data_set(motion_uart, motion_uart_isr, NULL);
+	if (ret < 0) {
+		LOG_ERR("motion uart irq callback: %d", ret);
+		return ret;
+	}
+	uart_irq_rx_enable(motion_uart);
+	k_thread_start(motion_rx_thread);
+
+	snprintf(banner, sizeof(banner), "start credits=%d\n", CONFIG_APP_MOTION_QUEUE_DEPTH);
+	motion_puts(banner);
+
+	while (true) {
+		/*
+			si la file est vide juste après un mouvement, le moteur s'arrête
+			en attendant le host: c'est un "underrun", y compris à la fin d'un travail.
+		*/
+		if (k_msgq_get(&motion_queue, &cmd, K_NO_WAIT) != 0) {
+			if (busy) {
+				motion_underruns++;
+				busy = false;
+			}
+			k_msgq_get(&motion_queue, &cmd, K_FOREVER);
+		}
+		busy = true;
+
+		/* l'emplacement est libéré dans la file: on rend le crédit avant d'exécuter */
+		motion_puts("ok\n");
+
+		/*
+			la ligne a déjà été acquittée: l'échec de l'exécution est signalé au host
+			par une ligne supplémentaire, qui ne rend pas de crédit.
+		*/
+		ret = motion_execute(motor, stop_event, &cmd);
+		if (ret < 0) {
+			char reply[32];
+
+			LOG_ERR("motion command %d failed: %d", cmd.type, ret);
+			snprintf(reply, sizeof(reply), "error:exec %d %d\n", cmd.type, ret);
+			motion_puts(reply);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	interface de commande de mouvement en flux continu sur uart (CONFIG_APP_MOTION_STREAM=y).
+
+	le host envoie des lignes de commande courtes, inspirées du G-code, qui sont analysées
+	et rangées dans une file de mouvements (le "planner"). la boucle principale exécute
+	les mouvements l'un après l'autre, sans attendre le host entre deux commandes.
+
+	une ligne fait au plus CONFIG_APP_MOTION_LINE_MAX - 2 octets (30 par défaut) avant sa fin
+	de ligne "\n" ou "\r\n", espaces et commentaire (après ';') compris, sinon elle est refusée
+	avec "error:line too long". c'est cette limite qui garantit que N lignes en vol tiennent
+	dans le buffer de réception: un host qui la dépasse peut perdre des octets.
+	le host peut supprimer les espaces avant l'envoi, la cible les ignore de toute façon.
+
+	commandes (valeurs entières, en pas et pas/s):
+	G0 X<pos> [F<vitesse>]	déplacement (G1 est identique)
+	G4 P<ms>				pause
+	G90 / G91				X absolu (par défaut) / relatif
+	G92 X<pos>				redéfinit la position courante
+	M17 / M18				active / désactive le driver du moteur
+	M114					position courante, réponse immédiate "X:<pos>"
+	?						état de la file, réponse immédiate "<q=... underruns=... overruns=...>"
+
+	contrôle de flux par crédits: au démarrage la cible annonce "start credits=<N>",
+	N étant la profondeur de la file. chaque ligne reçue consomme un crédit et est acquittée
+	par exactement une réponse "ok" ou "error:<raison>", qui rend le crédit. pour les mouvements,
+	le "ok" est envoyé lorsque le mouvement sort de la file pour être exécuté.
+	le host peut donc avoir jusqu'à N lignes en attente d'acquittement, la file ne déborde jamais,
+	et tant qu'il renvoie une ligne à chaque "ok" elle ne se vide jamais.
+
+	comme le "ok" d'un mouvement est envoyé avant son exécution, une erreur d'exécution
+	(mouvement avec le driver désactivé par M18, vitesse refusée par le driver...) est signalée
+	plus tard par une ligne "error:exec <type> <code>", qui n'acquitte aucune ligne et ne rend
+	pas de crédit. type vaut 0 (G0/G1), 1 (G4), 2 (G92) ou 3 (M17/M18), code est le code
+	d'erreur négatif retourné par le driver.
+
+	sans noeud app,motion-uart, les réponses partagent l'uart de la console avec le backend
+	de log uart, qui ne prend pas le même verrou: une ligne de log peut s'intercaler au milieu
+	d'un "ok" et le rendre méconnaissable pour le host, qui perd alors un crédit. pour un
+	usage réel, déclarer une uart dédiée dans l'overlay, ou désactiver CONFIG_LOG_BACKEND_UART.
+
+	avec CONFIG_APP_MOTION_XONXOFF=y, la cible envoie aussi XOFF (0x13) quand son buffer
+	de réception se remplit et XON (0x11) quand il se vide, pour un host qui ne compte pas les crédits.
+*/
+
+#ifndef MOTION_H_
+#define MOTION_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+/*
+	démarre la réception des commandes, puis exécute les mouvements de la file indéfiniment.
+	stop_event est l'évènement k_poll associé au signal levé par le callback du driver stepper
+	lorsqu'un mouvement est terminé.
+	ne retourne qu'en cas d'erreur.
+*/
+int motion_stream_run(const struct device *motor, struct k_poll_event *stop_event);
+
+#endif /* MOTION_H_ */
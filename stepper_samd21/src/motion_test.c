@@ -0,0 +1,259 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+/*
+	test du protocole de mouvement (CONFIG_APP_MOTION_TEST=y), sur native_sim avec
+	boards/motion_test.overlay. ce thread joue le rôle du host: il écrit les lignes de commande
+	dans la réception de l'uart émulée (uart_emul_put_rx_data) et relit les réponses
+	dans son émission (uart_emul_get_tx_data).
+
+	vérifications:
+	- bannière "start credits=N",
+	- réponses de G0/G4/G90/G91/G92/M17/M18/M114/? et position atteinte après les mouvements,
+	- erreurs: ligne trop longue (en octets bruts, commentaire compris), commande inconnue, codes non supportés, paramètres manquants,
+	- flux continu: le host garde N lignes en vol, chaque ligne reçoit exactement un "ok",
+	  et la cible ne signale ni overrun ni octet perdu.
+	en cas d'échec, la raison est affichée puis k_panic() arrête le programme.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/serial/uart_emul.h>
+
+#if !DT_HAS_CHOSEN(app_motion_uart)
+#error "CONFIG_APP_MOTION_TEST needs the emulated uart of boards/motion_test.overlay"
+#endif
+
+static const struct device *const test_uart = DEVICE_DT_GET(DT_CHOSEN(app_motion_uart));
+
+#define TEST_CREDITS CONFIG_APP_MOTION_QUEUE_DEPTH
+#define TEST_TIMEOUT_MS 1000
+#define TEST_QUIET_MS 200
+#define TEST_STREAM_LINES 200
+
+static void test_fail(const char *step, const char *expected, const char *got)
+{
+	printk("MOTION TEST FAIL: %s: expected \"%s\", got \"%s\"\n", step, expected, got);
+	k_panic();
+}
+
+static void test_send(const char *cmd)
+{
+	char line[64];
+	int len;
+
+	len = snprintf(line, sizeof(line), "%s\n", cmd);
+	if (uart_emul_put_rx_data(test_uart, (const uint8_t *)line, len) != (uint32_t)len) {
+		test_fail("send", "rx fifo space", cmd);
+	}
+}
+
+/* envoie cmd suivi d'un commentaire qui amène la ligne à raw_len octets avant le '\n' */
+static void test_send_padded(const char *cmd, size_t raw_len)
+{
+	char line[64];
+	size_t len;
+
+	len = snprintf(line, sizeof(line), "%s;", cmd);
+	while (len < raw_len && len < sizeof(line) - 1) {
+		line[len++] = 'x';
+	}
+	line[len] = '\0';
+	test_send(line);
+}
+
+/* lit une ligne de réponse sans le '\n', retourne false si elle n'arrive pas à temps */
+static bool test_readline(char *line, size_t size, int32_t timeout_ms)
+{
+	int64_t end = k_uptime_get() + timeout_ms;
+	size_t len = 0;
+	uint8_t c;
+
+	while (true) {
+		if (uart_emul_get_tx_data(test_uart, &c, 1) == 0) {
+			if (k_uptime_get() >= end) {
+				line[len] = '\0';
+				return false;
+			}
+			k_msleep(1);
+			continue;
+		}
+		if (c == '\n') {
+			line[len] = '\0';
+			return true;
+		}
+		if (len < size - 1) {
+			line[len++] = c;
+		}
+	}
+}
+
+static void test_expect(const char *step, const char *expected)
+{
+	char line[64];
+
+	if (!test_readline(line, sizeof(line), TEST_TIMEOUT_MS)) {
+		test_fail(step, expected, "<timeout>");
+	}
+	if (strcmp(line, expected) != 0) {
+		test_fail(step, expected, line);
+	}
+}
+
+/* envoie une commande et attend sa réponse, sans autre ligne avant */
+static void test_cmd(const char *cmd, const char *reply)
+{
+	test_send(cmd);
+	test_expect(cmd, reply);
+}
+
+static int32_t test_position(void)
+{
+	char line[64];
+	int pos;
+
+	test_send("M114");
+	if (!test_readline(line, sizeof(line), TEST_TIMEOUT_MS) ||
+	    sscanf(line, "X:%d", &pos) != 1) {
+		test_fail("M114", "X:<pos>", line);
+	}
+	test_expect("M114", "ok");
+	return pos;
+}
+
+/* le "ok" d'un mouvement arrive avant son exécution: on attend que la position soit atteinte */
+static void test_expect_position(int32_t expected)
+{
+	int64_t end = k_uptime_get() + TEST_TIMEOUT_MS;
+	char got[16];
+	int32_t pos;
+
+	while ((pos = test_position()) != expected) {
+		if (k_uptime_get() >= end) {
+			char want[16];
+
+			snprintf(want, sizeof(want), "X:%d", expected);
+			snprintf(got, sizeof(got), "X:%d", pos);
+			test_fail("position", want, got);
+		}
+		k_msleep(10);
+	}
+}
+
+static void test_status(unsigned int *overruns, unsigned int *lost)
+{
+	char line[64];
+	unsigned int used, depth, underruns;
+
+	test_send("?");
+	if (!test_readline(line, sizeof(line), TEST_TIMEOUT_MS) ||
+	    sscanf(line, "<q=%u/%u underruns=%u overruns=%u lost=%u>", &used, &depth,
+		   &underruns, overruns, lost) != 5) {
+		test_fail("?", "<q=... underruns=... overruns=... lost=...>", line);
+	}
+	test_expect("?", "ok");
+}
+
+static void test_commands(void)
+{
+	char expected[32];
+
+	snprintf(expected, sizeof(expected), "start credits=%d", TEST_CREDITS);
+	test_expect("banner", expected);
+
+	test_cmd("M114", "X:0");
+	test_expect("M114", "ok");
+
+	/* une ligne vide n'a pas de réponse, un commentaire seul est acquitté */
+	test_send("");
+	test_cmd("; commentaire", "ok");
+
+	test_cmd("G92 X100", "ok");
+	test_expect_position(100);
+
+	test_cmd("G91", "ok");
+	test_cmd("G0 X10 F1000", "ok");
+	test_cmd("G90", "ok");
+	test_expect_position(110);
+
+	test_cmd("g1 x0", "ok");
+	test_expect_position(0);
+
+	test_cmd("G4 P10", "ok");
+	test_cmd("M18", "ok");
+	test_cmd("M17", "ok");
+
+	test_cmd("Q1", "error:unknown command");
+	test_cmd("G", "error:bad command number");
+	test_cmd("G5 X1", "error:unsupported G code");
+	test_cmd("M5", "error:unsupported M code");
+	test_cmd("G0 F100", "error:missing X");
+	test_cmd("G0 X1 F0", "error:bad F");
+	test_cmd("G4", "error:bad P");
+	test_cmd("G92", "error:missing X");
+	test_cmd("G0 X1111111111111111111111111111111111111111", "error:line too long");
+
+	/*
+		la limite porte sur les octets bruts: une ligne courte une fois nettoyée
+		est refusée si ses espaces et son commentaire la rendent trop longue.
+	*/
+	test_send_padded("G4 P1 ", CONFIG_APP_MOTION_LINE_MAX - 2);
+	test_expect("line at the raw limit", "ok");
+	test_send_padded("G4 P1 ", CONFIG_APP_MOTION_LINE_MAX - 1);
+	test_expect("line over the raw limit", "error:line too long");
+}
+
+/*
+	le host garde TEST_CREDITS lignes en vol, comme scripts/motion_stream.py:
+	la file ne doit jamais déborder, et chaque ligne doit recevoir un seul "ok".
+*/
+static void test_stream(void)
+{
+	unsigned int overruns;
+	unsigned int lost;
+	char line[64];
+	char cmd[24];
+	int sent = 0;
+	int acked = 0;
+
+	while (acked < TEST_STREAM_LINES) {
+		while (sent < TEST_STREAM_LINES && sent - acked < TEST_CREDITS) {
+			snprintf(cmd, sizeof(cmd), "G0 X%d F5000", (sent % 2) * 4);
+			test_send(cmd);
+			sent++;
+		}
+		if (!test_readline(line, sizeof(line), TEST_TIMEOUT_MS)) {
+			test_fail("stream", "ok", "<timeout>");
+		}
+		if (strcmp(line, "ok") != 0) {
+			test_fail("stream", "ok", line);
+		}
+		acked++;
+	}
+
+	if (test_readline(line, sizeof(line), TEST_QUIET_MS)) {
+		test_fail("stream", "no more replies", line);
+	}
+
+	test_status(&overruns, &lost);
+	if (overruns != 0 || lost != 0) {
+		snprintf(line, sizeof(line), "overruns=%u lost=%u", overruns, lost);
+		test_fail("stream", "overruns=0 lost=0", line);
+	}
+	test_expect_position(((TEST_STREAM_LINES - 1) % 2) * 4);
+}
+
+static void motion_test_fn(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	test_commands();
+	test_stream();
+	printk("MOTION TEST PASS\n");
+}
+
+K_THREAD_DEFINE(motion_test_thread, 2048, motion_test_fn, NULL, NULL, NULL,
+		CONFIG_MAIN_THREAD_PRIORITY, 0, 0);